@@ -21,6 +21,16 @@ interface Stream<T> extends AsyncIterable<T> {
 }
 
 export default class LichessBot {
+  static MAX_SEARCH_DEPTH = 64;
+  static TRANSPOSITION_TABLE_SIZE = 32;
+  static THREAD_COUNT = 1;
+  static PONDER = true;
+  static MOVE_OVERHEAD = 500;
+  // the addon only probes the tables when built with Fathom: node-gyp rebuild --fathom_dir=<checkout>
+  static TABLEBASES_PATH = process.env.SYZYGY_PATH || '';
+  static BOOK_PATH = process.env.BOOK_PATH || '';
+  static NNUE_PATH = process.env.NNUE_PATH || '';
+
   token: string;
   name: string;
   isProduction: boolean;
@@ -137,6 +147,14 @@ export default class LichessBot {
     console.log(`game ${gameId.blue.bold} started. number of games: ${Object.keys(this.bots).length}`);
 
     const stream = this.createStream<LichessGameEvent>(`/api/bot/game/stream/${gameId}`);
+    let color = Color.WHITE;
+    // game states are handled one at a time without blocking the stream, so that a search can be stopped
+    let gameStates = Promise.resolve();
+    const handleGameState = (bot: Bot, gameState: LichessGameState) => {
+      gameStates = gameStates
+        .then(() => this.handleGameState(gameId, bot, color, gameState))
+        .catch((err) => console.log(err));
+    };
 
     for await (const event of stream) {
       if (event.type === 'gameFull') {
@@ -146,20 +164,32 @@ export default class LichessBot {
           existingBot.destroy();
         }
 
+        color = event.white.id === this.name ? Color.WHITE : Color.BLACK;
+
         const bot = this.bots[gameId] = new Bot(
           event.initialFen === 'startpos' ? Game.standardFen : event.initialFen,
-          event.white.id === this.name ? Color.WHITE : Color.BLACK,
-          event.speed === 'classical' || event.speed === 'correspondence'
-            ? 4 * 2
-            : 3 * 2
+          color,
+          LichessBot.MAX_SEARCH_DEPTH,
+          LichessBot.TRANSPOSITION_TABLE_SIZE,
+          LichessBot.THREAD_COUNT,
+          LichessBot.TABLEBASES_PATH,
+          LichessBot.BOOK_PATH,
+          LichessBot.NNUE_PATH
         );
 
-        this.handleGameState(gameId, bot, event.state);
+        handleGameState(bot, event.state);
       } else if (event.type === 'gameState') {
         const bot = this.bots[gameId];
 
-        if (bot) {
-          this.handleGameState(gameId, bot, event);
+        if (!bot) {
+          continue;
+        }
+
+        if (event.status === 'started') {
+          handleGameState(bot, event);
+        } else {
+          // resign, abort, flag etc.: the running search is of no use anymore
+          bot.stop();
         }
       }
     }
@@ -175,7 +205,7 @@ export default class LichessBot {
     console.log(`game ${gameId.blue.bold} ended. number of games: ${Object.keys(this.bots).length}`);
   }
 
-  handleGameState(gameId: string, bot: Bot, gameState: LichessGameState) {
+  async handleGameState(gameId: string, bot: Bot, color: Color, gameState: LichessGameState) {
     if (gameState.moves) {
       /*
       js code
@@ -197,10 +227,24 @@ export default class LichessBot {
     }
     */
 
-    const move = bot.makeMove();
+    const timeLeft = color === Color.WHITE ? gameState.wtime : gameState.btime;
+    const increment = color === Color.WHITE ? gameState.winc : gameState.binc;
+
+    // the search runs on a worker thread so that other games aren't blocked
+    const move = await bot.makeMoveAsync(timeLeft, increment, {
+      // never lose on time, whatever the time allocation decides
+      deadlineMs: timeLeft > 0
+        ? Date.now() + Math.max(timeLeft - LichessBot.MOVE_OVERHEAD, 1)
+        : undefined
+    });
 
     if (move) {
       this.sendMove(gameId, move);
+
+      // search the expected reply on the opponent's time
+      if (LichessBot.PONDER) {
+        bot.ponder(move);
+      }
     }
   }
 
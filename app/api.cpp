@@ -1,14 +1,21 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
 #include <string>
+#include <thread>
 #include <napi.h>
 
 #include "api.h"
 #include "bot.h"
 #include "gameUtils.h"
 #include "init.h"
+#include "searchPool.h"
 
 using namespace std;
+using namespace std::chrono;
 
 Napi::FunctionReference api::BotWrapper::constructor;
+SearchPool* api::searchPool;
 
 Napi::Object api::BotWrapper::Init(Napi::Env env, Napi::Object exports) {
   Napi::HandleScope scope(env);
@@ -17,6 +24,9 @@ Napi::Object api::BotWrapper::Init(Napi::Env env, Napi::Object exports) {
     InstanceMethod("applyMoves", &api::BotWrapper::ApplyMoves),
     InstanceMethod("destroy", &api::BotWrapper::Destroy),
     InstanceMethod("makeMove", &api::BotWrapper::MakeMove),
+    InstanceMethod("makeMoveAsync", &api::BotWrapper::MakeMoveAsync),
+    InstanceMethod("ponder", &api::BotWrapper::Ponder),
+    InstanceMethod("stop", &api::BotWrapper::Stop),
   });
 
   constructor = Napi::Persistent(func);
@@ -27,14 +37,56 @@ Napi::Object api::BotWrapper::Init(Napi::Env env, Napi::Object exports) {
   return exports;
 }
 
+api::SearchOptions api::getSearchOptions(const Napi::Value &value) {
+  api::SearchOptions options;
+
+  if (!value.IsObject()) {
+    return options;
+  }
+
+  Napi::Object object = value.As<Napi::Object>();
+  Napi::Value maxNodes = object.Get("maxNodes");
+  Napi::Value deadlineMs = object.Get("deadlineMs");
+
+  if (maxNodes.IsNumber()) {
+    options.maxNodes = max(maxNodes.As<Napi::Number>().Int32Value(), 0);
+  }
+
+  // the deadline comes as a Date.now() timestamp, the search needs the time left until it
+  if (deadlineMs.IsNumber()) {
+    int64_t now = duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+
+    options.deadline = int(clamp(deadlineMs.As<Napi::Number>().Int64Value() - now, int64_t(1), int64_t(INT32_MAX)));
+  }
+
+  return options;
+}
+
 api::BotWrapper::BotWrapper(const Napi::CallbackInfo &info) : Napi::ObjectWrap<BotWrapper>(info) {
   Napi::Env env = info.Env();
   Napi::HandleScope scope(env);
   Napi::String fen = info[0].As<Napi::String>();
   Napi::Number color = info[1].As<Napi::Number>();
-  Napi::Number searchDepth = info[2].As<Napi::Number>();
+  Napi::Number maxSearchDepth = info[2].As<Napi::Number>();
+  Napi::Number transpositionTableSize = info[3].As<Napi::Number>();
+  Napi::Number threadCount = info[4].As<Napi::Number>();
+  string tablebasesPath = info.Length() > 5 && info[5].IsString() ? string(info[5].As<Napi::String>()) : "";
+  string bookPath = info.Length() > 6 && info[6].IsString() ? string(info[6].As<Napi::String>()) : "";
+  string nnuePath = info.Length() > 7 && info[7].IsString() ? string(info[7].As<Napi::String>()) : "";
 
-  this->bot = new Bot(string(fen), Color(color.Int32Value()), searchDepth.Int32Value());
+  // the search starts as many threads as the pool reserves slots for, so it can't take more than the pool has
+  this->threadCount = clamp(threadCount.Int32Value(), 1, api::searchPool->getSlotCount());
+
+  this->bot = new Bot(
+    string(fen),
+    Color(color.Int32Value()),
+    maxSearchDepth.Int32Value(),
+    transpositionTableSize.Int32Value(),
+    this->threadCount,
+    tablebasesPath,
+    bookPath,
+    nnuePath
+  );
 }
 
 api::BotWrapper::~BotWrapper() {
@@ -43,30 +95,201 @@ api::BotWrapper::~BotWrapper() {
 
 void api::BotWrapper::destroy() {
   delete this->bot;
+
+  this->bot = nullptr;
+}
+
+bool api::BotWrapper::isAvailable(Napi::Env env) {
+  if (this->bot == nullptr || this->destroyRequested) {
+    Napi::Error::New(env, "Bot is destroyed").ThrowAsJavaScriptException();
+
+    return false;
+  }
+
+  if (this->searching) {
+    Napi::Error::New(env, "Bot is searching").ThrowAsJavaScriptException();
+
+    return false;
+  }
+
+  return true;
 }
 
 void api::BotWrapper::ApplyMoves(const Napi::CallbackInfo &info) {
+  if (!this->isAvailable(info.Env())) {
+    return;
+  }
+
   Napi::String moves = info[0].As<Napi::String>();
 
   this->bot->applyMoves(string(moves));
 }
 
 void api::BotWrapper::Destroy(const Napi::CallbackInfo &info) {
+  // the bot is still used by the worker thread, it's deleted when the search finishes
+  if (this->searching) {
+    this->destroyRequested = true;
+    this->stopRequested = true;
+    this->bot->stop();
+
+    return;
+  }
+
   this->destroy();
 }
 
 Napi::Value api::BotWrapper::MakeMove(const Napi::CallbackInfo &info) {
   Napi::Env env = info.Env();
-  Move move = this->bot->makeMove();
+
+  if (!this->isAvailable(env)) {
+    return env.Undefined();
+  }
+
+  Napi::Number timeLeft = info[0].As<Napi::Number>();
+  Napi::Number increment = info[1].As<Napi::Number>();
+  api::SearchOptions options = api::getSearchOptions(info[2]);
+
+  this->bot->clearStopRequest();
+
+  Move move = this->bot->makeMove(timeLeft.Int32Value(), increment.Int32Value(), options.maxNodes, options.deadline);
 
   return move == NO_MOVE
     ? env.Null()
     : Napi::Number::New(env, move);
 }
 
+Napi::Value api::BotWrapper::MakeMoveAsync(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+
+  if (!this->isAvailable(env)) {
+    return env.Undefined();
+  }
+
+  Napi::Number timeLeft = info[0].As<Napi::Number>();
+  Napi::Number increment = info[1].As<Napi::Number>();
+  auto job = new api::MakeMoveJob(
+    env,
+    this,
+    timeLeft.Int32Value(),
+    increment.Int32Value(),
+    api::getSearchOptions(info[2])
+  );
+
+  // cleared here rather than by the search: a stop arriving before the job runs must not be lost
+  this->bot->clearStopRequest();
+  this->searching = true;
+
+  api::searchPool->push(this->threadCount, [job]() {
+    job->run();
+  });
+
+  return job->getPromise();
+}
+
+void api::BotWrapper::Stop(const Napi::CallbackInfo &info) {
+  if (this->bot == nullptr) {
+    return;
+  }
+
+  // a job that hasn't started yet is skipped altogether
+  if (this->searching) {
+    this->stopRequested = true;
+  }
+
+  this->bot->stop();
+}
+
+Napi::Value api::BotWrapper::Ponder(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+
+  if (!this->isAvailable(env)) {
+    return env.Undefined();
+  }
+
+  Napi::Number move = info[0].As<Napi::Number>();
+
+  this->bot->clearStopRequest();
+
+  Move ponderMove = this->bot->ponder(Move(move.Int32Value()));
+
+  return ponderMove == NO_MOVE
+    ? env.Null()
+    : Napi::Number::New(env, ponderMove);
+}
+
+api::MakeMoveJob::MakeMoveJob(
+  Napi::Env env,
+  api::BotWrapper* wrapper,
+  int timeLeft,
+  int increment,
+  api::SearchOptions options
+) : deferred(Napi::Promise::Deferred::New(env)) {
+  this->increment = increment;
+  this->options = options;
+  this->timeLeft = timeLeft;
+  this->wrapper = wrapper;
+  // keeps the wrapper from being garbage collected while the search is running
+  this->wrapperReference = Napi::Persistent(wrapper->Value());
+  // the result is handed back to the main thread through a thread-safe function
+  this->completion = Napi::ThreadSafeFunction::New(
+    env,
+    Napi::Function::New(env, [](const Napi::CallbackInfo &info) {}),
+    "makeMove",
+    0,
+    1
+  );
+}
+
+Napi::Promise api::MakeMoveJob::getPromise() {
+  return this->deferred.Promise();
+}
+
+void api::MakeMoveJob::resolve(Napi::Env env) {
+  this->wrapper->searching = false;
+  this->wrapper->stopRequested = false;
+
+  if (this->wrapper->destroyRequested) {
+    this->wrapper->destroy();
+    this->deferred.Resolve(env.Null());
+
+    return;
+  }
+
+  this->deferred.Resolve(
+    this->move == NO_MOVE
+      ? env.Null()
+      : Napi::Number::New(env, this->move)
+  );
+}
+
+void api::MakeMoveJob::run() {
+  // the job is deleted on the main thread, so the thread-safe function is released through a copy
+  Napi::ThreadSafeFunction completion = this->completion;
+
+  // the search may have been stopped while the job was waiting in the queue
+  if (!this->wrapper->stopRequested) {
+    this->move = this->wrapper->bot->makeMove(
+      this->timeLeft,
+      this->increment,
+      this->options.maxNodes,
+      this->options.deadline
+    );
+  }
+
+  completion.BlockingCall(this, [](Napi::Env env, Napi::Function callback, api::MakeMoveJob* job) {
+    job->resolve(env);
+
+    delete job;
+  });
+  completion.Release();
+}
+
 Napi::Object initAddonApi(Napi::Env env, Napi::Object exports) {
   init::init();
 
+  // never deleted: searches may still be running when the process exits
+  api::searchPool = new SearchPool(thread::hardware_concurrency());
+
   api::BotWrapper::Init(env, exports);
 
   return exports;
@@ -1,7 +1,9 @@
+#include <atomic>
 #include <string>
 #include <napi.h>
 
 #include "bot.h"
+#include "searchPool.h"
 
 #ifndef API_INCLUDED
 #define API_INCLUDED
@@ -17,12 +19,51 @@ namespace api {
     void                destroy();
 
   private:
+    friend class MakeMoveJob;
+
     static Napi::FunctionReference constructor;
     void                           ApplyMoves(const Napi::CallbackInfo &info);
     void                           Destroy(const Napi::CallbackInfo &info);
     Napi::Value                    MakeMove(const Napi::CallbackInfo &info);
-    Bot* bot;
+    Napi::Value                    MakeMoveAsync(const Napi::CallbackInfo &info);
+    Napi::Value                    Ponder(const Napi::CallbackInfo &info);
+    void                           Stop(const Napi::CallbackInfo &info);
+    bool                           isAvailable(Napi::Env env);
+    Bot*                           bot;
+    atomic<bool>                   destroyRequested = false;
+    bool                           searching = false;
+    atomic<bool>                   stopRequested = false;
+    int                            threadCount;
+  };
+
+  struct SearchOptions {
+    int deadline = 0;
+    int maxNodes = 0;
   };
+
+  class MakeMoveJob {
+  public:
+    MakeMoveJob(Napi::Env env, BotWrapper* wrapper, int timeLeft, int increment, SearchOptions options);
+    Napi::Promise getPromise();
+    void          run();
+
+  private:
+    Napi::ThreadSafeFunction completion;
+    Napi::Promise::Deferred  deferred;
+    int                      increment;
+    Move                     move = NO_MOVE;
+    SearchOptions            options;
+    int                      timeLeft;
+    BotWrapper*              wrapper;
+    Napi::ObjectReference    wrapperReference;
+
+    void resolve(Napi::Env env);
+  };
+
+  // all games in the process share the cores through this pool
+  extern SearchPool* searchPool;
+
+  SearchOptions getSearchOptions(const Napi::Value &value);
 }
 
 Napi::Object Init(Napi::Env env, Napi::Object exports);
@@ -0,0 +1,59 @@
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench.h"
+#include "bot.h"
+#include "gameUtils.h"
+#include "utils.h"
+
+using namespace std;
+using namespace std::chrono;
+
+int BENCH_DEPTH = 7;
+int BENCH_TRANSPOSITION_TABLE_SIZE = 64;
+vector<int> benchThreadCounts = {1, 2, 4, 8, 16};
+vector<string> benchFens = {
+  "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+  "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+  "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+  "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1"
+};
+
+int bench::timeToDepth(const string &fen, int depth, int threadCount) {
+  Color color = utils::split(fen, " ")[1] == "w" ? WHITE : BLACK;
+  Bot bot(fen, color, depth, BENCH_TRANSPOSITION_TABLE_SIZE, threadCount, "", "", "");
+  auto timestamp = high_resolution_clock::now();
+
+  bot.makeMove(0, 0, 0, 0);
+
+  return duration_cast<milliseconds>(high_resolution_clock::now() - timestamp).count();
+}
+
+void bench::benchMain() {
+  vector<int> times;
+
+  for (auto &threadCount : benchThreadCounts) {
+    int time = 0;
+
+    for (auto &fen : benchFens) {
+      time += bench::timeToDepth(fen, BENCH_DEPTH, threadCount);
+    }
+
+    times.push_back(time);
+  }
+
+  cout << "time to depth " << BENCH_DEPTH << " (hardware threads: " << thread::hardware_concurrency() << ")" << endl;
+
+  for (size_t i = 0; i < benchThreadCounts.size(); i++) {
+    cout
+      << "threads: " << utils::formatString(to_string(benchThreadCounts[i]), {"blue", "bold"})
+      << ", time: " << utils::formatString(to_string(times[i]), {"red", "bold"}) << " ms"
+      << ", speedup: " << utils::formatString(
+        times[i] == 0 ? "NaN" : to_string(1.0 * times[0] / times[i]).substr(0, 4),
+        {"green", "bold"}
+      ) << endl;
+  }
+}
@@ -0,0 +1,14 @@
+#include <string>
+#include <vector>
+
+#ifndef BENCH_INCLUDED
+#define BENCH_INCLUDED
+
+using namespace std;
+
+namespace bench {
+  void benchMain();
+  int  timeToDepth(const string &fen, int depth, int threadCount);
+}
+
+#endif // BENCH_INCLUDED
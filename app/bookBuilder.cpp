@@ -0,0 +1,418 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bookBuilder.h"
+#include "game.h"
+#include "gameUtils.h"
+#include "openingBook.h"
+#include "utils.h"
+
+using namespace std;
+using namespace std::chrono;
+
+const int BOOK_BATCH_SIZE = 1000;
+const int BOOK_DEFAULT_MAX_PLY = 30;
+const int BOOK_DEFAULT_MEMORY_SIZE = 512;
+const int BOOK_MAX_PLY_LIMIT = 256;
+const int BOOK_MAX_WEIGHT = 65535;
+const int BOOK_MIN_GAMES = 2;
+// a table has to fit all moves of one game after it's been found not full
+const size_t BOOK_MIN_TABLE_SIZE = 4 * BOOK_MAX_PLY_LIMIT;
+const int BOOK_PROGRESS_INTERVAL = 100000;
+const string STANDARD_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+BookStatsTable::BookStatsTable(size_t capacity) {
+  // a power of 2, so that the key can be masked into an index
+  this->capacity = 1;
+
+  while (this->capacity * 2 <= capacity) {
+    this->capacity *= 2;
+  }
+
+  this->entries.resize(this->capacity);
+}
+
+void BookStatsTable::add(ZobristKey key, uint16_t move, int result) {
+  size_t index = (key ^ move * 0x9E3779B97F4A7C15ULL) & (this->capacity - 1);
+
+  // moves are never 0 (a1a1), so an empty move marks a free slot
+  while (this->entries[index].move != 0 && (this->entries[index].key != key || this->entries[index].move != move)) {
+    index = (index + 1) & (this->capacity - 1);
+  }
+
+  BookMoveStats* entry = &this->entries[index];
+
+  if (entry->move == 0) {
+    *entry = {key, move, 0, 0, 0};
+    this->size++;
+  }
+
+  if (result > 0) {
+    entry->wins++;
+  } else if (result < 0) {
+    entry->losses++;
+  } else {
+    entry->draws++;
+  }
+}
+
+bool BookStatsTable::isFull() {
+  return this->size >= this->capacity / 4 * 3;
+}
+
+void BookStatsTable::spill(const string &path) {
+  auto last = partition(this->entries.begin(), this->entries.end(), [](auto &entry) { return entry.move != 0; });
+
+  sort(this->entries.begin(), last, [](auto &entry1, auto &entry2) {
+    return entry1.key != entry2.key ? entry1.key < entry2.key : entry1.move < entry2.move;
+  });
+
+  ofstream file(path, ios::binary);
+
+  file.write((const char*)this->entries.data(), (last - this->entries.begin()) * sizeof(BookMoveStats));
+
+  fill(this->entries.begin(), this->entries.end(), BookMoveStats{0, 0, 0, 0, 0});
+  this->size = 0;
+}
+
+// replays one game and counts its moves up to the max ply
+bool addGame(const string &pgn, Game* startGame, BookStatsTable* table, int maxPly) {
+  int result = 2;
+  string movetext;
+
+  for (auto &line : utils::split(pgn, "\n")) {
+    if (line.rfind("[Result ", 0) == 0) {
+      result = line.find("\"1-0\"") != string::npos
+        ? 1
+        : line.find("\"0-1\"") != string::npos
+          ? -1
+          : line.find("\"1/2-1/2\"") != string::npos
+            ? 0
+            : 2;
+    } else if (line.rfind("[FEN ", 0) == 0) {
+      // only games from the standard starting position make it into the book
+      if (line.find(STANDARD_FEN.substr(0, STANDARD_FEN.find(' '))) == string::npos) {
+        return false;
+      }
+    } else if (line[0] != '[') {
+      movetext += line.substr(0, line.find(';')) + " ";
+    }
+  }
+
+  if (result == 2) {
+    return false;
+  }
+
+  // comments and variations are skipped
+  string mainline;
+  int depth = 0;
+
+  for (size_t i = 0; i < movetext.length(); i++) {
+    char c = movetext[i];
+
+    if (c == '{') {
+      i = movetext.find('}', i);
+
+      if (i == string::npos) {
+        break;
+      }
+
+      mainline += ' ';
+    } else if (c == '(' || c == ')') {
+      depth += c == '(' ? 1 : -1;
+      mainline += ' ';
+    } else if (depth == 0) {
+      mainline += c == '\t' || c == '\r' ? ' ' : c;
+    }
+  }
+
+  Game game(*startGame);
+  int ply = 0;
+
+  for (auto &token : utils::split(mainline, " ")) {
+    if (ply == maxPly) {
+      break;
+    }
+
+    // move numbers, annotations and the result
+    size_t moveStart = token.find_last_of('.');
+    string san = moveStart == string::npos ? token : token.substr(moveStart + 1);
+
+    if (san.empty() || san[0] == '$' || isdigit(san[0]) || san == "*") {
+      continue;
+    }
+
+    Move move = game.sanToMove(san);
+
+    if (move == NO_MOVE) {
+      break;
+    }
+
+    table->add(game.getPolyglotKey(), game.getPolyglotMove(move), ply % 2 == 0 ? result : -result);
+    game.performMove(move);
+    ply++;
+  }
+
+  return true;
+}
+
+void writeBook(const vector<string> &runPaths, const string &bookPath, int* entriesCount) {
+  vector<ifstream> runs;
+  // the smallest (key, move) record of each run
+  auto isGreater = [](auto &item1, auto &item2) {
+    return item1.first.key != item2.first.key
+      ? item1.first.key > item2.first.key
+      : item1.first.move > item2.first.move;
+  };
+  priority_queue<pair<BookMoveStats, size_t>, vector<pair<BookMoveStats, size_t>>, decltype(isGreater)> heads(isGreater);
+
+  for (size_t i = 0; i < runPaths.size(); i++) {
+    BookMoveStats stats;
+
+    runs.emplace_back(runPaths[i], ios::binary);
+
+    if (runs[i].read((char*)&stats, sizeof(BookMoveStats))) {
+      heads.push({stats, i});
+    }
+  }
+
+  ofstream book(bookPath, ios::binary);
+  vector<BookMoveStats> positionMoves;
+
+  auto writePosition = [&book, &positionMoves, entriesCount]() {
+    vector<pair<uint16_t, int>> weightedMoves;
+    int maxWeight = 0;
+
+    for (auto &stats : positionMoves) {
+      int weight = 2 * stats.wins + stats.draws;
+
+      if (stats.wins + stats.draws + stats.losses >= BOOK_MIN_GAMES && weight > 0) {
+        weightedMoves.emplace_back(stats.move, weight);
+        maxWeight = max(maxWeight, weight);
+      }
+    }
+
+    sort(weightedMoves.begin(), weightedMoves.end(), [](auto &move1, auto &move2) { return move1.second > move2.second; });
+
+    for (auto &[move, weight] : weightedMoves) {
+      uint8_t entry[BOOK_ENTRY_SIZE] = {};
+      ZobristKey key = positionMoves[0].key;
+      int scaledWeight = maxWeight > BOOK_MAX_WEIGHT
+        ? max(int(int64_t(weight) * BOOK_MAX_WEIGHT / maxWeight), 1)
+        : weight;
+
+      // big-endian key, move and weight, the learn field stays empty
+      for (int i = 0; i < 8; i++) {
+        entry[i] = uint8_t(key >> (56 - 8 * i));
+      }
+
+      entry[8] = uint8_t(move >> 8);
+      entry[9] = uint8_t(move);
+      entry[10] = uint8_t(scaledWeight >> 8);
+      entry[11] = uint8_t(scaledWeight);
+
+      book.write((const char*)entry, BOOK_ENTRY_SIZE);
+      (*entriesCount)++;
+    }
+
+    positionMoves.clear();
+  };
+
+  while (!heads.empty()) {
+    auto [stats, runIndex] = heads.top();
+
+    heads.pop();
+
+    // the same move of the same position may come from several runs
+    if (!positionMoves.empty() && positionMoves.back().key == stats.key && positionMoves.back().move == stats.move) {
+      positionMoves.back().wins += stats.wins;
+      positionMoves.back().draws += stats.draws;
+      positionMoves.back().losses += stats.losses;
+    } else {
+      if (!positionMoves.empty() && positionMoves.back().key != stats.key) {
+        writePosition();
+      }
+
+      positionMoves.push_back(stats);
+    }
+
+    if (runs[runIndex].read((char*)&stats, sizeof(BookMoveStats))) {
+      heads.push({stats, runIndex});
+    }
+  }
+
+  if (!positionMoves.empty()) {
+    writePosition();
+  }
+}
+
+void bookBuilder::buildBook(const string &pgnPath, const string &bookPath, int maxPly, int threadCount, int memorySize) {
+  ifstream pgn(pgnPath);
+
+  if (!pgn) {
+    cerr << "failed to open " << pgnPath << endl;
+
+    return;
+  }
+
+  auto start = high_resolution_clock::now();
+  Game startGame(STANDARD_FEN);
+
+  // games keep their position keys in a fixed size list
+  maxPly = min(maxPly, BOOK_MAX_PLY_LIMIT);
+  // games are read in batches, at most a few batches per thread are kept in memory
+  queue<vector<string>> batches;
+  mutex batchesMutex;
+  condition_variable batchesChanged;
+  bool isReadingDone = false;
+  mutex runPathsMutex;
+  vector<string> runPaths;
+  atomic<int> gamesCount = 0;
+  vector<thread> workers;
+  size_t tableCapacity = max(size_t(memorySize) * 1024 * 1024 / threadCount / sizeof(BookMoveStats), BOOK_MIN_TABLE_SIZE);
+
+  for (int i = 0; i < threadCount; i++) {
+    workers.emplace_back([&]() {
+      BookStatsTable table(tableCapacity);
+
+      auto spill = [&]() {
+        lock_guard<mutex> lock(runPathsMutex);
+        string runPath = bookPath + ".run" + to_string(runPaths.size()) + ".tmp";
+
+        table.spill(runPath);
+        runPaths.push_back(runPath);
+      };
+
+      while (true) {
+        vector<string> batch;
+
+        {
+          unique_lock<mutex> lock(batchesMutex);
+
+          batchesChanged.wait(lock, [&]() { return !batches.empty() || isReadingDone; });
+
+          if (batches.empty()) {
+            break;
+          }
+
+          batch = move(batches.front());
+          batches.pop();
+        }
+
+        batchesChanged.notify_all();
+
+        for (auto &game : batch) {
+          if (addGame(game, &startGame, &table, maxPly)) {
+            int count = ++gamesCount;
+
+            if (count % BOOK_PROGRESS_INTERVAL == 0) {
+              cout << "games: " << count << endl;
+            }
+          }
+
+          if (table.isFull()) {
+            spill();
+          }
+        }
+      }
+
+      spill();
+    });
+  }
+
+  vector<string> batch;
+  string game;
+  string line;
+  bool hasMovetext = false;
+
+  auto pushBatch = [&]() {
+    unique_lock<mutex> lock(batchesMutex);
+
+    batchesChanged.wait(lock, [&]() { return batches.size() < size_t(2 * threadCount); });
+    batches.push(move(batch));
+    batch.clear();
+    lock.unlock();
+    batchesChanged.notify_all();
+  };
+
+  while (getline(pgn, line)) {
+    // a header after the movetext starts the next game
+    if (!line.empty() && line[0] == '[' && hasMovetext) {
+      batch.push_back(move(game));
+      game.clear();
+      hasMovetext = false;
+
+      if (batch.size() == BOOK_BATCH_SIZE) {
+        pushBatch();
+      }
+    }
+
+    if (!line.empty() && line[0] != '[') {
+      hasMovetext = true;
+    }
+
+    game += line + "\n";
+  }
+
+  if (hasMovetext) {
+    batch.push_back(move(game));
+  }
+
+  pushBatch();
+
+  {
+    lock_guard<mutex> lock(batchesMutex);
+
+    isReadingDone = true;
+  }
+
+  batchesChanged.notify_all();
+
+  for (auto &worker : workers) {
+    worker.join();
+  }
+
+  int entriesCount = 0;
+
+  writeBook(runPaths, bookPath, &entriesCount);
+
+  for (auto &runPath : runPaths) {
+    remove(runPath.c_str());
+  }
+
+  cout
+    << "games: " << utils::formatString(to_string(gamesCount), {"blue", "bold"})
+    << ", book entries: " << utils::formatString(to_string(entriesCount), {"red", "bold"})
+    << ", time: " << duration_cast<milliseconds>(high_resolution_clock::now() - start).count() << " ms" << endl;
+}
+
+void bookBuilder::buildBookMain(int argc, char** argv) {
+  int maxPly = BOOK_DEFAULT_MAX_PLY;
+  int threadCount = max(int(thread::hardware_concurrency()), 1);
+  int memorySize = BOOK_DEFAULT_MEMORY_SIZE;
+
+  if (
+    argc < 4
+    || (argc > 4 && !utils::parsePositiveInt(argv[4], &maxPly))
+    || (argc > 5 && !utils::parsePositiveInt(argv[5], &threadCount))
+    || (argc > 6 && !utils::parsePositiveInt(argv[6], &memorySize))
+  ) {
+    cerr
+      << "usage: " << argv[0] << " --buildBook <games.pgn> <book.bin> [max ply] [threads] [memory in MB]" << endl
+      << "max ply, threads and memory are positive integers" << endl;
+
+    return;
+  }
+
+  bookBuilder::buildBook(argv[2], argv[3], maxPly, threadCount, memorySize);
+}
@@ -0,0 +1,41 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "gameUtils.h"
+
+#ifndef BOOK_BUILDER_INCLUDED
+#define BOOK_BUILDER_INCLUDED
+
+using namespace std;
+
+// results are counted from the point of view of the side to move
+struct BookMoveStats {
+  ZobristKey key;
+  uint16_t   move;
+  uint32_t   wins;
+  uint32_t   draws;
+  uint32_t   losses;
+};
+
+// open addressing table of (position, move) stats, sorted and written to a run file when full
+class BookStatsTable {
+public:
+  explicit BookStatsTable(size_t capacity);
+
+  void add(ZobristKey key, uint16_t move, int result);
+  bool isFull();
+  void spill(const string &path);
+
+protected:
+  size_t                capacity;
+  vector<BookMoveStats> entries;
+  size_t                size = 0;
+};
+
+namespace bookBuilder {
+  void buildBook(const string &pgnPath, const string &bookPath, int maxPly, int threadCount, int memorySize);
+  void buildBookMain(int argc, char** argv);
+}
+
+#endif // BOOK_BUILDER_INCLUDED
@@ -1,22 +1,241 @@
 #include <algorithm>
+#include <chrono>
 #include <ctime>
 #include <iostream>
 #include <random>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "bot.h"
+#include "evalWeights.h"
 #include "game.h"
 #include "gameUtils.h"
 #include "utils.h"
 
 using namespace std;
-
+using namespace std::chrono;
+
+const int ASPIRATION_WINDOW = 300;
+const int DELTA_PRUNING_MARGIN = 2000;
+const int EXPECTED_MOVES_LEFT = 30;
+const int FUTILITY_MARGIN = 1500;
+const int FUTILITY_MAX_DEPTH = 3;
+const int HISTORY_MAX = 16384;
+const int LATE_MOVE_REDUCTION_MIN_DEPTH = 3;
+const int LATE_MOVE_REDUCTION_MIN_INDEX = 3;
+const int MAX_ASPIRATION_WINDOW = 5000;
+const int NULL_MOVE_DEEP_REDUCTION_DEPTH = 6;
+const int NULL_MOVE_MIN_DEPTH = 2;
+const int MOVE_OVERHEAD = 100;
+const size_t MULTI_PV_COUNT = 4;
 const int OPTIMAL_MOVE_THRESHOLD = 50;
-
-Bot::Bot(const string &fen, Color color, int searchDepth) : Game(fen) {
+const int PAWN_TABLE_SIZE = 16384;
+const int RAZORING_MARGIN = 3000;
+const int RAZORING_MAX_DEPTH = 3;
+const int REVERSE_FUTILITY_MARGIN = 1200;
+const int REVERSE_FUTILITY_MAX_DEPTH = 3;
+const int SEARCH_LIMITS_CHECK_INTERVAL = 1024;
+const int TABLEBASE_MAX_DTZ = 1 << 18;
+const int TABLEBASE_PROBE_DEPTH_BONUS = 6;
+const int TABLEBASE_WIN_SCORE = 500000;
+
+// ponder searches run outside the search pool, next to the searches of all games: only a few of them
+// run at a time, each on a single thread and for a limited number of nodes
+const int PONDER_MAX_NODES = 5000000;
+const int PONDER_MAX_SEARCHES = max(int(thread::hardware_concurrency()) / 4, 1);
+atomic<int> ponderSearchesCount = 0;
+
+// helper threads skip some iterations so that they don't all search the same depth at the same time
+const int HELPER_SKIPS_COUNT = 20;
+const int HELPER_SKIP_SIZES[HELPER_SKIPS_COUNT] = {1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4};
+const int HELPER_SKIP_PHASES[HELPER_SKIPS_COUNT] = {0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7};
+
+Bot::Bot(
+  const string &fen,
+  Color color,
+  int maxSearchDepth,
+  int transpositionTableSize,
+  int threadCount,
+  const string &tablebasesPath,
+  const string &bookPath,
+  const string &nnuePath
+) : Game(fen) {
   this->color = color;
-  this->searchDepth = searchDepth;
+  this->maxSearchDepth = min(maxSearchDepth, MAX_SEARCH_DEPTH);
+  this->threadCount = max(threadCount, 1);
+  this->openingBook = OpeningBook::get(bookPath);
+  this->tablebases = Tablebases::get(tablebasesPath);
+  this->transpositionTable = new TranspositionTable(transpositionTableSize);
+  this->pawnTable = new PawnTable(PAWN_TABLE_SIZE);
+
+  this->setNnue(Nnue::get(nnuePath));
+}
+
+Bot::Bot(const Bot &bot) : Game(bot) {
+  this->color = bot.color;
+  this->maxSearchDepth = bot.maxSearchDepth;
+  this->threadCount = 1;
+  this->openingBook = bot.openingBook;
+  this->tablebases = bot.tablebases;
+  this->transpositionTable = bot.transpositionTable;
+  this->pawnTable = new PawnTable(PAWN_TABLE_SIZE);
+
+  // helpers start with the main thread's move ordering knowledge
+  copy(&bot.counterMoves[0][0], &bot.counterMoves[0][0] + 64 * 64, &this->counterMoves[0][0]);
+  copy(&bot.history[0][0][0], &bot.history[0][0][0] + 2 * 64 * 64, &this->history[0][0][0]);
+}
+
+Bot::~Bot() {
+  if (this->ponderThread.joinable()) {
+    this->stopPondering();
+  }
+
+  if (this->threadIndex == 0) {
+    delete this->transpositionTable;
+  }
+
+  delete this->pawnTable;
+}
+
+void Bot::applyMoves(const string &moves) {
+  if (this->ponderThread.joinable()) {
+    vector<string> split = utils::split(moves, " ");
+    // the position is being searched, so the move count can't be read here
+    size_t ponderMovesStart = this->ponderMoveCount;
+
+    // our move has been played, the opponent is still thinking
+    if (
+      split.size() == ponderMovesStart + 1
+      && split[ponderMovesStart] == gameUtils::moveToUci(this->ponderMoves[0])
+    ) {
+      return;
+    }
+
+    if (
+      split.size() == ponderMovesStart + 2
+      && split[ponderMovesStart] == gameUtils::moveToUci(this->ponderMoves[0])
+      && split[ponderMovesStart + 1] == gameUtils::moveToUci(this->ponderMoves[1])
+    ) {
+      this->ponderHit = true;
+
+      return;
+    }
+
+    this->stopPondering();
+  }
+
+  Game::applyMoves(moves);
+}
+
+void Bot::allocateTime(int timeLeft, int increment, int deadline) {
+  if (timeLeft <= 0) {
+    this->optimalTime = 0;
+    this->maximumTime = 0;
+  } else {
+    int availableTime = max(timeLeft - MOVE_OVERHEAD, 1);
+
+    this->maximumTime = max(min(availableTime / 4, 4 * (availableTime / EXPECTED_MOVES_LEFT + increment)), 1);
+    this->optimalTime = min(availableTime / EXPECTED_MOVES_LEFT + increment * 3 / 4, this->maximumTime);
+  }
+
+  // the deadline is a hard limit on top of the clock
+  if (deadline > 0) {
+    this->maximumTime = this->maximumTime == 0 ? deadline : min(this->maximumTime, deadline);
+    this->optimalTime = min(this->optimalTime, this->maximumTime);
+  }
+}
+
+Score Bot::aspirationSearch(Score previousScore) {
+  int window = ASPIRATION_WINDOW;
+  Score alpha = previousScore - window;
+  Score beta = previousScore + window;
+
+  while (true) {
+    Score score = -this->executeNegamax(1, this->searchDepth - 1, -beta, -alpha);
+
+    if (this->searchStopped) {
+      return score;
+    }
+
+    // the window is widened on the failing side until the score falls inside it
+    if (score <= alpha && alpha > -INFINITE_SCORE) {
+      window *= 2;
+      alpha = window > MAX_ASPIRATION_WINDOW ? -INFINITE_SCORE : previousScore - window;
+    } else if (score >= beta && beta < INFINITE_SCORE) {
+      window *= 2;
+      beta = window > MAX_ASPIRATION_WINDOW ? INFINITE_SCORE : previousScore + window;
+    } else {
+      return score;
+    }
+  }
+}
+
+void Bot::checkSearchLimits() {
+  // searchStopped is reset by every search, a stop requested before the search prepared itself is kept here
+  if (this->stopRequested) {
+    this->searchStopped = true;
+
+    return;
+  }
+
+  // pondering has no limits until the opponent plays the expected move. the limits of the ponder hit are
+  // only handed over by makeMove, this thread is the only one that reads and writes its own limits
+  if (this->pondering) {
+    if (!this->ponderHitLimitsReady) {
+      if (this->nodes >= PONDER_MAX_NODES) {
+        this->ponderNodesExhausted = true;
+        this->searchStopped = true;
+      }
+
+      return;
+    }
+
+    PonderHitLimits* limits = &this->ponderHitLimits;
+
+    this->searchStart = limits->start;
+    this->maxNodes = limits->maxNodes;
+    this->allocateTime(limits->timeLeft, limits->increment, limits->deadline);
+    // nodes searched on the opponent's time don't count against the node limit of our move
+    this->searchStartNodes = this->nodes;
+    this->pondering = false;
+  }
+
+  // the first iteration is always completed so that there is a move to play
+  if (this->searchDepth == 1) {
+    return;
+  }
+
+  if (this->maxNodes != 0 && this->nodes - this->searchStartNodes >= this->maxNodes) {
+    this->searchStopped = true;
+  } else if (
+    this->maximumTime != 0
+    && this->nodes % SEARCH_LIMITS_CHECK_INTERVAL == 0
+    && this->getElapsedTime() >= this->maximumTime
+  ) {
+    this->searchStopped = true;
+  }
+}
+
+Score Bot::captureScore(Move move) {
+  Square to = gameUtils::getMoveTo(move);
+  PieceType promotion = gameUtils::getMovePromotion(move);
+  PieceType pieceType = this->board[gameUtils::getMoveFrom(move)]->type;
+  Piece* toPiece = this->board[to];
+  // en passant captures a pawn on an empty square
+  int capturedWorth = toPiece == this->noPiece ? gameUtils::piecesWorth[PAWN] : gameUtils::piecesWorth[toPiece->type];
+
+  if (promotion != NO_PIECE) {
+    capturedWorth += gameUtils::piecesWorth[promotion] - gameUtils::piecesWorth[PAWN];
+  }
+
+  // most valuable victim, least valuable attacker (king captures are always safe)
+  return Score(100 * capturedWorth - (pieceType == KING ? 0 : gameUtils::piecesWorth[pieceType]));
+}
+
+// a new search is requested: the stop requests of the previous ones don't apply to it
+void Bot::clearStopRequest() {
+  this->stopRequested = false;
 }
 
 Score Bot::eval(int depth) {
@@ -28,54 +247,31 @@ Score Bot::eval(int depth) {
     return SCORE_EQUAL;
   }
 
-  auto currentPawnScore = this->evaluatedPawnPositions[this->turn].find(this->pawnKey);
-  bool foundPawnScore = currentPawnScore != this->evaluatedPawnPositions[this->turn].end();
-  PositionInfo positionInfo;
+  return this->evalStatic();
+}
 
-  for (Color color = WHITE; color < NO_COLOR; ++color) {
-    Piece** pieces = this->pieces[color];
-    int pieceCount = this->pieceCounts[color];
-
-    for (int i = 0; i < pieceCount; i++) {
-      Piece* piece = pieces[i];
-
-      if (piece->type == PAWN) {
-        Rank rank = gameUtils::squareRanks[piece->square];
-        File file = gameUtils::squareFiles[piece->square];
-
-        if (foundPawnScore) {
-          positionInfo.pawnFiles[color][file].min = rank;
-          positionInfo.pawnFiles[color][file].max = rank;
-        } else {
-          FileInfo* fileInfo = &positionInfo.pawnFiles[color][file];
-
-          if (fileInfo->min == NO_RANK) {
-            fileInfo->min = rank;
-            fileInfo->max = rank;
-          } else {
-            fileInfo->min = min(rank, fileInfo->min);
-            fileInfo->max = max(rank, fileInfo->max);
-          }
-
-          positionInfo.pawns[color].push(piece);
-        }
-      }
-    }
+Score Bot::evalStatic() {
+  if (this->nnue) {
+    this->updateAccumulator(WHITE);
+    this->updateAccumulator(BLACK);
+
+    return this->nnue->evaluate(this->accumulator, this->turn);
   }
 
-  Score pawnsScore = foundPawnScore
-    ? currentPawnScore->second
-    : this->evalPawns(this->turn, &positionInfo) - this->evalPawns(~this->turn, &positionInfo);
+  PawnEntry* pawnEntry = this->pawnTable->probe(this->pawnKey);
 
-  if (!foundPawnScore) {
-    this->evaluatedPawnPositions[this->turn][this->pawnKey] = pawnsScore;
+  // a traced evaluation has to count the pawn terms, so it can't use the cached score
+  if (pawnEntry->key != this->pawnKey || this->trace) {
+    this->evalPawnStructure(pawnEntry);
   }
 
-  return pawnsScore + this->evalColor(this->turn, &positionInfo) - this->evalColor(~this->turn, &positionInfo);
+  Score pawnsScore = this->turn == WHITE ? pawnEntry->score : -pawnEntry->score;
+
+  return pawnsScore + this->evalColor(this->turn, pawnEntry) - this->evalColor(~this->turn, pawnEntry);
 }
 
-Score Bot::evalColor(Color color, PositionInfo *positionInfo) {
-  return this->evalKingSafety(color) + this->evalPieces(color, positionInfo);
+Score Bot::evalColor(Color color, PawnEntry* pawnEntry) {
+  return this->evalKingSafety(color) + this->evalPieces(color, pawnEntry);
 }
 
 Score Bot::evalKingSafety(Color color) {
@@ -89,15 +285,15 @@ Score Bot::evalKingSafety(Color color) {
   bool isWhite = color == WHITE;
 
   if (isWhite ? kingRank > gameUtils::ranks[color][RANK_4] : kingRank < gameUtils::ranks[color][RANK_4]) {
-    return Score(-3000);
+    return Score(this->evalWeight(KING_BEYOND_RANK_4, color));
   }
 
   if (kingRank == gameUtils::ranks[color][RANK_4]) {
-    return Score(-2000);
+    return Score(this->evalWeight(KING_ON_RANK_4, color));
   }
 
   if (kingRank == gameUtils::ranks[color][RANK_3]) {
-    return Score(-1000);
+    return Score(this->evalWeight(KING_ON_RANK_3, color));
   }
 
   if (
@@ -106,16 +302,16 @@ Score Bot::evalKingSafety(Color color) {
     && kingFile <= FILE_F
   ) {
     return kingFile == FILE_D || kingFile == FILE_E
-      ? Score(-750)
-      : Score(-500);
+      ? Score(this->evalWeight(KING_ON_RANK_2_CENTER, color))
+      : Score(this->evalWeight(KING_ON_RANK_2_NEAR_CENTER, color));
   }
 
   if (kingFile == FILE_D || kingFile == FILE_E) {
-    return Score(-250);
+    return Score(this->evalWeight(KING_ON_CENTER_FILE, color));
   }
 
   if (kingFile == FILE_F) {
-    return Score(-100);
+    return Score(this->evalWeight(KING_ON_F_FILE, color));
   }
 
   Rank upperRank = kingRank + (isWhite ? 1 : -1);
@@ -127,18 +323,19 @@ Score Bot::evalKingSafety(Color color) {
   defendingPieces.push(this->board[gameUtils::squares[upperRank][kingFile]]);
   defendingPieces.push(this->board[gameUtils::squares[upperRank][kingFile + 1]]);
 
-  int score = kingRank == gameUtils::ranks[color][RANK_1] && kingFile == FILE_C ? 0 : 100;
+  int score = kingRank == gameUtils::ranks[color][RANK_1] && kingFile == FILE_C ? 0 : this->evalWeight(KING_CASTLED, color);
 
   for (auto &piece : defendingPieces) {
     if (piece->color == color) {
-      score += (
+      score += this->evalWeight(
         gameUtils::squareRanks[piece->square] == upperRank
           ? piece->type == PAWN
-            ? 100
-            : 50
+            ? KING_SHIELD_PAWN
+            : KING_SHIELD_PIECE
           : piece->type == PAWN
-            ? 50
-            : 25
+            ? KING_SIDE_PAWN
+            : KING_SIDE_PIECE,
+        color
       );
     }
   }
@@ -146,11 +343,40 @@ Score Bot::evalKingSafety(Color color) {
   return Score(score);
 }
 
-Score Bot::evalPawns(Color color, PositionInfo *positionInfo) {
+void Bot::evalPawnStructure(PawnEntry* pawnEntry) {
+  pawnEntry->key = this->pawnKey;
+
+  for (Color color = WHITE; color < NO_COLOR; ++color) {
+    Bitboard pawns = this->bitboards[color][PAWN];
+
+    for (auto &fileInfo : pawnEntry->pawnFiles[color]) {
+      fileInfo = FileInfo();
+    }
+
+    while (pawns) {
+      Square square = gameUtils::popBitboardSquare(&pawns);
+      Rank rank = gameUtils::squareRanks[square];
+      FileInfo* fileInfo = &pawnEntry->pawnFiles[color][gameUtils::squareFiles[square]];
+
+      if (fileInfo->min == NO_RANK) {
+        fileInfo->min = rank;
+        fileInfo->max = rank;
+      } else {
+        fileInfo->min = min(rank, fileInfo->min);
+        fileInfo->max = max(rank, fileInfo->max);
+      }
+    }
+  }
+
+  // passed pawns of one side depend on the files of the other, so the score needs all files first
+  pawnEntry->score = this->evalPawns(WHITE, pawnEntry) - this->evalPawns(BLACK, pawnEntry);
+}
+
+Score Bot::evalPawns(Color color, PawnEntry* pawnEntry) {
   bool isWhite = color == WHITE;
-  List<Piece*, 64>* pawns = &positionInfo->pawns[color];
-  FileInfo* pawnFiles = positionInfo->pawnFiles[color];
-  FileInfo* opponentPawnFiles = positionInfo->pawnFiles[~color];
+  Bitboard pawns = this->bitboards[color][PAWN];
+  FileInfo* pawnFiles = pawnEntry->pawnFiles[color];
+  FileInfo* opponentPawnFiles = pawnEntry->pawnFiles[~color];
   int score = 0;
   bool islandState = false;
   int islandsCount = 0;
@@ -162,7 +388,7 @@ Score Bot::evalPawns(Color color, PositionInfo *positionInfo) {
       islandState = false;
     } else {
       if (fileInfo->max != fileInfo->min) {
-        score -= 300;
+        score += this->evalWeight(DOUBLED_PAWNS, color);
       }
 
       if (!islandState) {
@@ -173,41 +399,44 @@ Score Bot::evalPawns(Color color, PositionInfo *positionInfo) {
     }
   }
 
-  for (auto &pawn : *pawns) {
-    File file = gameUtils::squareFiles[pawn->square];
-    Rank rank = gameUtils::squareRanks[pawn->square];
+  while (pawns) {
+    Square square = gameUtils::popBitboardSquare(&pawns);
+    File file = gameUtils::squareFiles[square];
+    Rank rank = gameUtils::squareRanks[square];
     FileInfo* leftInfo = file == FILE_A ? nullptr : &opponentPawnFiles[file - 1];
     FileInfo* fileInfo = &opponentPawnFiles[file];
     FileInfo* rightInfo = file == FILE_H ? nullptr : &opponentPawnFiles[file + 1];
 
-    score += 2 * gameUtils::allPieceSquareTables[color][PAWN][0][pawn->square];
+    score += 2 * gameUtils::allPieceSquareTables[color][PAWN][0][square];
+
+    this->traceWeight(evalWeights::getPieceSquareWeight(color, PAWN, false, square), color, 2);
 
     if (
       (leftInfo == nullptr || leftInfo->min == NO_RANK || (isWhite ? leftInfo->max <= rank : leftInfo->min >= rank))
       && (fileInfo->min == NO_RANK || (isWhite ? fileInfo->max <= rank : fileInfo->min >= rank))
       && (rightInfo == nullptr || rightInfo->min == NO_RANK || (isWhite ? rightInfo->max <= rank : rightInfo->min >= rank))
     ) {
-      score += 500 + (
+      score += this->evalWeight(PASSED_PAWN, color) + (
         rank == gameUtils::ranks[color][RANK_7]
-          ? 1000
+          ? this->evalWeight(PASSED_PAWN_RANK_7, color)
           : rank == gameUtils::ranks[color][RANK_6]
-            ? 500
+            ? this->evalWeight(PASSED_PAWN_RANK_6, color)
             : rank == gameUtils::ranks[color][RANK_5]
-              ? 200
+              ? this->evalWeight(PASSED_PAWN_RANK_5, color)
               : 0
       );
     }
   }
 
-  return Score(score + (islandsCount - 1) * -200);
+  return Score(score + this->evalWeight(PAWN_ISLAND, color, islandsCount - 1));
 }
 
-Score Bot::evalPieces(Color color, PositionInfo *positionInfo) {
+Score Bot::evalPieces(Color color, PawnEntry* pawnEntry) {
   bool isEndgame = this->isEndgame();
   Piece** pieces = this->pieces[color];
   int pieceCount = this->pieceCounts[color];
   Color opponentColor = ~color;
-  int hangingPiecesCoeff = this->turn == color ? 100 : 1000;
+  AttackInfo* attackInfo = this->getAttackInfo();
   int bishopsCount = 0;
   int score = 0;
 
@@ -216,26 +445,21 @@ Score Bot::evalPieces(Color color, PositionInfo *positionInfo) {
     Rank rank = gameUtils::squareRanks[piece->square];
     File file = gameUtils::squareFiles[piece->square];
 
-    // piece-square tables
-    score += 10 * gameUtils::allPieceSquareTables[color][piece->type][isEndgame][piece->square];
+    // piece-square tables are summed up incrementally, only a traced evaluation needs them per piece
+    this->traceWeight(evalWeights::getPieceSquareWeight(color, piece->type, isEndgame, piece->square), color, 10);
 
     // development
-    score += (
-      (
-        (piece->type == KNIGHT || piece->type == BISHOP)
-        && rank == gameUtils::ranks[color][RANK_1]
-      )
-        ? -300
-        : (
-          piece->type == PAWN
-          && (file == FILE_D || file == FILE_E)
-          && rank == gameUtils::ranks[color][RANK_2]
-        )
-          ? this->board[piece->square + (color == WHITE ? NORTH : SOUTH)] == this->noPiece
-            ? -300
-            : -1000
-          : 0
-    );
+    if ((piece->type == KNIGHT || piece->type == BISHOP) && rank == gameUtils::ranks[color][RANK_1]) {
+      score += this->evalWeight(UNDEVELOPED_MINOR, color);
+    } else if (
+      piece->type == PAWN
+      && (file == FILE_D || file == FILE_E)
+      && rank == gameUtils::ranks[color][RANK_2]
+    ) {
+      score += this->board[piece->square + (color == WHITE ? NORTH : SOUTH)] == this->noPiece
+        ? this->evalWeight(CENTER_PAWN_UNMOVED, color)
+        : this->evalWeight(CENTER_PAWN_BLOCKED, color);
+    }
 
     // eval bishop pair
     if (piece->type == BISHOP) {
@@ -243,143 +467,266 @@ Score Bot::evalPieces(Color color, PositionInfo *positionInfo) {
     }
 
     // rooks on open/semi-open files
-    if (piece->type == ROOK && positionInfo->pawnFiles[color][file].min == NO_RANK) {
-      score += 100 + (positionInfo->pawnFiles[opponentColor][file].min == NO_RANK ? 100 : 0);
+    if (piece->type == ROOK && pawnEntry->pawnFiles[color][file].min == NO_RANK) {
+      score += this->evalWeight(ROOK_SEMI_OPEN_FILE, color) + (
+        pawnEntry->pawnFiles[opponentColor][file].min == NO_RANK
+          ? this->evalWeight(ROOK_OPEN_FILE, color)
+          : 0
+      );
     }
 
     // control
     if (piece->type != KING || isEndgame) {
-      Bitboard attacks = this->getAttacks(piece);
+      Bitboard attacks = attackInfo->pieceAttacks[piece->square];
       Bitboard* squareRings = gameUtils::squareRings[this->kings[opponentColor]->square];
 
       if (isEndgame) {
-        score += 20 * __builtin_popcountll(attacks);
+        score += this->evalWeight(ENDGAME_MOBILITY, color, __builtin_popcountll(attacks));
       } else {
         ControlBitboards* controlBitboards = &gameUtils::controlBitboards[color];
 
         score += (
-          50 * __builtin_popcountll(attacks & controlBitboards->center)
-          + 25 * __builtin_popcountll(attacks & controlBitboards->aroundCenter)
-          + 20 * __builtin_popcountll(attacks & controlBitboards->opponent)
-          + 10 * __builtin_popcountll(attacks & controlBitboards->unimportant)
+          this->evalWeight(CENTER_CONTROL, color, __builtin_popcountll(attacks & controlBitboards->center))
+          + this->evalWeight(AROUND_CENTER_CONTROL, color, __builtin_popcountll(attacks & controlBitboards->aroundCenter))
+          + this->evalWeight(OPPONENT_SIDE_CONTROL, color, __builtin_popcountll(attacks & controlBitboards->opponent))
+          + this->evalWeight(OTHER_CONTROL, color, __builtin_popcountll(attacks & controlBitboards->unimportant))
         );
       }
 
       score += (
-        150 * __builtin_popcountll(attacks & squareRings[0])
-        + 50 * __builtin_popcountll(attacks & squareRings[1])
+        this->evalWeight(KING_RING_ATTACK, color, __builtin_popcountll(attacks & squareRings[0]))
+        + this->evalWeight(KING_OUTER_RING_ATTACK, color, __builtin_popcountll(attacks & squareRings[1]))
       );
     }
+  }
+
+  return Score(
+    score
+    + this->material[color] * 1000
+    + this->pieceSquareScores[color][isEndgame] * 10
+    + (bishopsCount >= 2 ? this->evalWeight(BISHOP_PAIR, color) : 0)
+  );
+}
 
-    // hanging pieces
-    if (piece->type != KING) {
-      Bitboard attackingPieces = this->getAttacksTo(piece->square, opponentColor);
+inline int Bot::evalWeight(EvalWeight weight, Color color, int count) {
+  this->traceWeight(weight, color, count);
 
-      if (attackingPieces) {
-        Bitboard defendingPieces = this->getAttacksTo(piece->square, color);
+  return evalWeights::weights[weight] * count;
+}
+
+Score Bot::executeNegamax(int depth, int remainingDepth, Score alpha, Score beta) {
+  this->nodes++;
+  this->checkSearchLimits();
 
-        if (defendingPieces) {
-          PieceType pieceToTake = piece->type;
-          bool state = false;
-          List<int, 32> lossStates;
+  if (this->searchStopped) {
+    return SCORE_EQUAL;
+  }
 
-          lossStates.push(0);
+  // never the root: a repetition on the current path is a draw whatever the table stored for the position
+  if (this->isDraw()) {
+    return SCORE_EQUAL;
+  }
 
-          while (true) {
-            Bitboard* pieces = state ? &defendingPieces : &attackingPieces;
+  TranspositionEntry entry;
+  Move hashMove = NO_MOVE;
 
-            if (!*pieces) {
-              break;
-            }
+  if (this->transpositionTable->probe(this->positionKey, &entry)) {
+    Score score = this->scoreFromTranspositionTable(entry.getScore(), depth);
+    Bound bound = entry.bound();
 
-            lossStates.push(state ? gameUtils::piecesWorth[pieceToTake] : -gameUtils::piecesWorth[pieceToTake]);
+    hashMove = entry.getMove();
 
-            pieceToTake = this->getLeastWorthAttacker(pieces, state ? color : opponentColor);
-            state = !state;
-          }
+    if (
+      entry.depth >= remainingDepth
+      && (
+        bound == EXACT_BOUND
+        || (bound == LOWER_BOUND && score >= beta)
+        || (bound == UPPER_BOUND && score <= alpha)
+      )
+    ) {
+      return score;
+    }
+  }
 
-          lossStates.push(lossStates[lossStates.size() - 1]);
+  if (remainingDepth <= 0) {
+    Score score = this->quiesce(depth, alpha, beta);
 
-          int maxWin = -10000;
-          int maxWinIndex = 0;
-          int minLoss = 10000;
-          int minLossIndex = 0;
-          int loss = 0;
+    if (!this->searchStopped) {
+      this->transpositionTable->store(
+        this->positionKey,
+        0,
+        score >= beta ? LOWER_BOUND : score <= alpha ? UPPER_BOUND : EXACT_BOUND,
+        this->scoreToTranspositionTable(score, depth),
+        NO_MOVE
+      );
+    }
 
-          for (size_t i = 0; i < lossStates.size(); i++) {
-            loss += lossStates[i];
+    return score;
+  }
 
-            if (i & 1) {
-              if (maxWin < loss) {
-                maxWin = loss;
-                maxWinIndex = i;
-              }
-            } else {
-              if (minLoss > loss) {
-                minLoss = loss;
-                minLossIndex = i;
-              }
-            }
-          }
+  // tablebases know the result only right after a capture or a pawn move and without castling rights
+  if (
+    this->tablebases
+    && this->pliesFor50MoveRule == 0
+    && this->possibleCastling == NO_CASTLING
+    && __builtin_popcountll(this->boardBitboard) <= this->tablebases->getCardinality()
+  ) {
+    TablebasePosition position;
+    WdlScore wdl;
+
+    this->getTablebasePosition(&position);
+
+    if (this->tablebases->probeWdl(&position, &wdl)) {
+      // cursed wins and blessed losses are drawn by the 50 move rule
+      Score score = Score(wdl > WDL_CURSED_WIN ? TABLEBASE_WIN_SCORE : wdl < WDL_BLESSED_LOSS ? -TABLEBASE_WIN_SCORE : SCORE_EQUAL);
+      Bound bound = wdl > WDL_CURSED_WIN ? LOWER_BOUND : wdl < WDL_BLESSED_LOSS ? UPPER_BOUND : EXACT_BOUND;
+
+      if (bound == EXACT_BOUND || (bound == LOWER_BOUND ? score >= beta : score <= alpha)) {
+        this->transpositionTable->store(
+          this->positionKey,
+          min(remainingDepth + TABLEBASE_PROBE_DEPTH_BONUS, MAX_SEARCH_DEPTH - 1),
+          bound,
+          score,
+          NO_MOVE
+        );
 
-          score += (minLossIndex < maxWinIndex ? minLoss : maxWin) * hangingPiecesCoeff;
-        } else {
-          score -= gameUtils::piecesWorth[piece->type] * hangingPiecesCoeff;
-        }
+        return score;
       }
     }
   }
 
-  return Score(score + this->material[color] * 1000 + (bishopsCount >= 2 ? 500 : 0));
-}
+  bool isPvNode = beta - alpha > 1;
+  bool isFutile = false;
 
-Score Bot::executeNegamax(int depth, Score alpha, Score beta) {
-  if (depth == this->searchDepth) {
-    auto currentScore = this->evaluatedPositions.find(this->positionKey);
-    bool found = currentScore != this->evaluatedPositions.end();
-    Score score = found ? currentScore->second : this->eval(depth);
+  // margin-based pruning near the leaves: the static eval is trusted to be close to the search result
+  if (!isPvNode && !this->checkers && remainingDepth <= FUTILITY_MAX_DEPTH) {
+    Score staticEval = this->evalStatic();
 
-    if (!found) {
-      this->evaluatedPositions[this->positionKey] = score;
+    // reverse futility pruning: even giving away the margin keeps the score above beta
+    if (
+      remainingDepth <= REVERSE_FUTILITY_MAX_DEPTH
+      && !this->isMateScore(beta)
+      && staticEval - REVERSE_FUTILITY_MARGIN * remainingDepth >= beta
+    ) {
+      return beta;
     }
 
-    this->nodes++;
+    // razoring: hopelessly below alpha, only captures can change anything
+    if (remainingDepth <= RAZORING_MAX_DEPTH && staticEval + RAZORING_MARGIN * remainingDepth < alpha) {
+      Score score = this->quiesce(depth, alpha, beta);
 
-    return score;
-  }
+      if (this->searchStopped) {
+        return SCORE_EQUAL;
+      }
 
-  if (this->isDraw()) {
-    return SCORE_EQUAL;
+      if (score <= alpha) {
+        return alpha;
+      }
+    }
+
+    // futility pruning: quiet moves can't bring the score up to alpha
+    isFutile = !this->isMateScore(alpha) && staticEval + FUTILITY_MARGIN * remainingDepth <= alpha;
   }
 
-  List<Move, 256> legalMoves(this->getAllLegalMoves(legalMoves.list));
+  // null move pruning: if passing the turn still fails high, a real move most likely will too.
+  // never done at PV nodes, twice in a row, in check or when only the king and pawns are left (zugzwang is likely)
+  if (
+    !isPvNode
+    && !this->checkers
+    && remainingDepth >= NULL_MOVE_MIN_DEPTH
+    && this->moveStack[depth - 1] != NO_MOVE
+    && !this->isMateScore(beta)
+    && this->pieceCounts[this->turn] - __builtin_popcountll(this->bitboards[this->turn][PAWN]) > 1
+    && this->pieceCounts[WHITE] + this->pieceCounts[BLACK] - this->pawnCount > 3
+  ) {
+    int reduction = remainingDepth > NULL_MOVE_DEEP_REDUCTION_DEPTH ? 3 : 2;
+    MoveInfo moveInfo = this->performNullMove();
 
-  if (legalMoves.empty()) {
-    return this->checkers ? this->getMateScore(depth) : SCORE_EQUAL;
+    this->moveStack[depth] = NO_MOVE;
+
+    Score score = -this->executeNegamax(depth + 1, remainingDepth - 1 - reduction, -beta, -(beta - 1));
+
+    this->revertNullMove(&moveInfo);
+
+    if (this->searchStopped) {
+      return SCORE_EQUAL;
+    }
+
+    if (score >= beta) {
+      return beta;
+    }
   }
 
-  bool isEndgame = this->isEndgame();
-  List<MoveWithScore, 256> legalMovesWithScores;
+  Move previousMove = this->moveStack[depth - 1];
+  Move* killers = this->killerMoves[depth];
+  Move counterMove = previousMove == NO_MOVE
+    ? NO_MOVE
+    : this->counterMoves[gameUtils::getMoveFrom(previousMove)][gameUtils::getMoveTo(previousMove)];
+  MovePicker picker;
 
-  legalMovesWithScores.last += legalMoves.size();
+  picker.hashMove = hashMove;
 
-  for (size_t i = 0; i < legalMoves.size(); i++) {
-    legalMovesWithScores[i].move = legalMoves[i];
-    legalMovesWithScores[i].score = this->moveScore(legalMoves[i], isEndgame);
+  for (auto &refutation : {killers[0], killers[1], counterMove}) {
+    if (refutation != NO_MOVE && refutation != hashMove && !picker.refutations.contains(refutation)) {
+      picker.refutations.push(refutation);
+    }
   }
 
-  sort(
-    legalMovesWithScores.list,
-    legalMovesWithScores.last,
-    [](auto &move1, auto &move2) { return move2.score < move1.score;}
-  );
+  Move bestMove = NO_MOVE;
+  List<Move, 256> quietMoves;
+  size_t i = 0;
+
+  for (Move move = this->pickMove(&picker); move != NO_MOVE; move = this->pickMove(&picker), i++) {
+    bool isQuiet = !this->isCaptureOrPromotion(move);
+    MoveInfo moveInfo = this->performMove(move);
+    Score score;
+
+    // checks are never futile, and at least one move is always searched
+    if (isFutile && isQuiet && i != 0 && !this->checkers) {
+      this->revertMove(&moveInfo);
+
+      continue;
+    }
+
+    this->moveStack[depth] = move;
+
+    // principal variation search: moves after the first one only have to prove they are not better than alpha
+    if (i == 0) {
+      score = -this->executeNegamax(depth + 1, remainingDepth - 1, -beta, -alpha);
+    } else {
+      int reduction = 0;
+
+      // late move reductions: quiet moves late in the list are searched shallower first
+      if (
+        remainingDepth >= LATE_MOVE_REDUCTION_MIN_DEPTH
+        && i >= LATE_MOVE_REDUCTION_MIN_INDEX
+        && isQuiet
+        && !moveInfo.prevCheckers
+        && !this->checkers
+      ) {
+        reduction = min(
+          gameUtils::lateMoveReductions[min(remainingDepth, 63)][min((int)i, 63)],
+          remainingDepth - 2
+        );
+      }
 
-  for (size_t i = 0; i < legalMovesWithScores.size(); i++) {
-    MoveInfo moveInfo = this->performMove(legalMovesWithScores[i].move);
-    Score score = -this->executeNegamax(depth + 1, -beta, -alpha);
+      score = -this->executeNegamax(depth + 1, remainingDepth - 1 - reduction, -(alpha + 1), -alpha);
+
+      if (reduction > 0 && score > alpha) {
+        score = -this->executeNegamax(depth + 1, remainingDepth - 1, -(alpha + 1), -alpha);
+      }
+
+      if (score > alpha && score < beta) {
+        score = -this->executeNegamax(depth + 1, remainingDepth - 1, -beta, -alpha);
+      }
+    }
 
     this->revertMove(&moveInfo);
 
+    if (this->searchStopped) {
+      return SCORE_EQUAL;
+    }
+
     if (score >= beta) {
       if (i == 0) {
         this->firstCutNodesCount++;
@@ -387,30 +734,112 @@ Score Bot::executeNegamax(int depth, Score alpha, Score beta) {
 
       this->cutNodesCount++;
 
+      if (isQuiet) {
+        this->updateQuietMoveStats(move, depth, remainingDepth, &quietMoves);
+      }
+
+      this->transpositionTable->store(
+        this->positionKey,
+        remainingDepth,
+        LOWER_BOUND,
+        this->scoreToTranspositionTable(beta, depth),
+        move
+      );
+
       return beta;
     }
 
     if (score > alpha) {
       alpha = score;
+      bestMove = move;
+    }
+
+    if (isQuiet) {
+      quietMoves.push(move);
     }
   }
 
+  if (i == 0) {
+    return this->checkers ? this->getMateScore(depth) : SCORE_EQUAL;
+  }
+
+  this->transpositionTable->store(
+    this->positionKey,
+    remainingDepth,
+    bestMove == NO_MOVE ? UPPER_BOUND : EXACT_BOUND,
+    this->scoreToTranspositionTable(alpha, depth),
+    bestMove
+  );
+
   return alpha;
 }
 
-PieceType Bot::getLeastWorthAttacker(Bitboard* attackers, Color color) {
-  for (PieceType pieceType = PAWN; pieceType >= KING; --pieceType) {
-    Bitboard pieceTypeAttackers = *attackers & this->bitboards[color][pieceType];
+Move Bot::getPonderMove(Move move) {
+  MoveInfo moveInfo = this->performMove(move);
+  TranspositionEntry entry;
+  Move ponderMove = NO_MOVE;
+
+  // the best reply found by the search is still in the transposition table
+  if (this->transpositionTable->probe(this->positionKey, &entry) && this->isLegalMove(entry.getMove())) {
+    ponderMove = entry.getMove();
+  }
+
+  this->revertMove(&moveInfo);
+
+  return ponderMove;
+}
+
+int Bot::getElapsedTime() {
+  return duration_cast<milliseconds>(steady_clock::now() - this->searchStart).count();
+}
+
+Move Bot::getBookMove() {
+  if (!this->openingBook) {
+    return NO_MOVE;
+  }
+
+  vector<BookEntry> entries;
+
+  this->openingBook->getEntries(this->getPolyglotKey(), &entries);
+
+  int totalWeight = 0;
+
+  for (auto &entry : entries) {
+    totalWeight += entry.weight;
+  }
+
+  if (totalWeight == 0) {
+    return NO_MOVE;
+  }
+
+  std::default_random_engine generator(clock());
+  std::uniform_int_distribution<int> distribution(0, totalWeight - 1);
+  int pickedWeight = distribution(generator);
+  uint16_t bookMove = 0;
+
+  for (auto &entry : entries) {
+    pickedWeight -= entry.weight;
+
+    if (pickedWeight < 0) {
+      bookMove = entry.move;
 
-    if (pieceTypeAttackers) {
-      Square square = gameUtils::getBitboardSquare(pieceTypeAttackers);
-      *attackers ^= square;
+      break;
+    }
+  }
+
+  List<Move, 256> legalMoves(this->getAllLegalMoves(legalMoves.list));
+
+  for (auto &move : legalMoves) {
+    if (this->getPolyglotMove(move) == bookMove) {
+      cout
+        << "book move " << utils::formatString(gameUtils::moveToUci(move), {"red", "bold"})
+        << " (" << entries.size() << " candidates)" << endl;
 
-      return this->board[square]->type;
+      return move;
     }
   }
 
-  return NO_PIECE;
+  return NO_MOVE;
 }
 
 Score Bot::getMateScore(int depth) {
@@ -424,61 +853,155 @@ Move Bot::getOptimalMove() {
     return NO_MOVE;
   }
 
+  // only the moves keeping the best tablebase result are searched
+  if (
+    this->tablebases
+    && this->possibleCastling == NO_CASTLING
+    && __builtin_popcountll(this->boardBitboard) <= this->tablebases->getCardinality()
+  ) {
+    if (!this->probeRootMoves(&legalMoves)) {
+      cerr << "tablebase probe failed, searching all moves" << endl;
+    }
+  }
+
   if (legalMoves.size() == 1) {
     cout << "only move " << utils::formatString(gameUtils::moveToUci(legalMoves[0]), {"red", "bold"}) << endl;
 
     return legalMoves[0];
   }
 
-  List<MoveWithScore, 256> legalMovesWithScores;
+  bool isEndgame = this->isEndgame();
+  List<MoveWithScore, 256> rootMoves;
 
-  legalMovesWithScores.last += legalMoves.last - legalMoves.list;
+  rootMoves.last += legalMoves.size();
 
   for (size_t i = 0; i < legalMoves.size(); i++) {
-    MoveInfo moveInfo = this->performMove(legalMoves[i]);
-    Score score = -this->eval(1);
-
-    this->revertMove(&moveInfo);
-
-    legalMovesWithScores[i].move = legalMoves[i];
-    legalMovesWithScores[i].score = score;
+    rootMoves[i].move = legalMoves[i];
+    rootMoves[i].score = this->moveScore(legalMoves[i], isEndgame);
   }
 
   sort(
-    legalMovesWithScores.list, legalMovesWithScores.last,
+    rootMoves.list, rootMoves.last,
     [](auto &move1, auto &move2) { return move2.score < move1.score; }
   );
 
   List<MoveWithScore, 256> optimalMoves;
 
-  for (auto &legalMoves : legalMovesWithScores) {
-    MoveInfo moveInfo = this->performMove(legalMoves.move);
-    Score maxScore = -INFINITE_SCORE;
+  for (int depth = 1; depth <= this->maxSearchDepth; depth++) {
+    List<MoveWithScore, 256> iterationMoves;
+    // the best moves with exact scores, sorted
+    List<MoveWithScore, 256> pvMoves;
+
+    this->searchDepth = depth;
+
+    for (auto &rootMove : rootMoves) {
+      // a move needs an exact score only if it gets into the top moves and is close enough to the best one
+      Score bound = pvMoves.empty()
+        ? -INFINITE_SCORE
+        : max(
+          Score(pvMoves[0].score - OPTIMAL_MOVE_THRESHOLD),
+          pvMoves.size() == MULTI_PV_COUNT ? pvMoves[MULTI_PV_COUNT - 1].score : -INFINITE_SCORE
+        );
+      MoveInfo moveInfo = this->performMove(rootMove.move);
+      Score score;
+
+      this->moveStack[0] = rootMove.move;
+
+      if (iterationMoves.empty() && !optimalMoves.empty() && !this->isMateScore(optimalMoves[0].score)) {
+        // the previous best move is searched with an aspiration window around its previous score
+        score = this->aspirationSearch(optimalMoves[0].score);
+      } else if (bound == -INFINITE_SCORE) {
+        score = -this->executeNegamax(1, this->searchDepth - 1, -INFINITE_SCORE, INFINITE_SCORE);
+      } else {
+        // other moves first only have to prove they beat the bound
+        score = -this->executeNegamax(1, this->searchDepth - 1, -(bound + 1), -bound);
+
+        if (score > bound && !this->searchStopped) {
+          score = -this->executeNegamax(1, this->searchDepth - 1, -INFINITE_SCORE, -bound);
+        }
+      }
+
+      this->revertMove(&moveInfo);
+
+      if (this->searchStopped) {
+        break;
+      }
+
+      MoveWithScore* last = iterationMoves.last++;
+
+      last->move = rootMove.move;
+      last->score = score;
+
+      if (score > bound) {
+        MoveWithScore* pvMove = pvMoves.last++;
+
+        *pvMove = *last;
+
+        // keep the list sorted: move the new entry up to its place
+        while (pvMove != pvMoves.list && (pvMove - 1)->score < pvMove->score) {
+          swap(*pvMove, *(pvMove - 1));
+          pvMove--;
+        }
 
-    for (auto &optimalMove : optimalMoves) {
-      if (optimalMove.score > maxScore) {
-        maxScore = optimalMove.score;
+        if (pvMoves.size() > MULTI_PV_COUNT) {
+          pvMoves.pop();
+        }
       }
     }
 
-    Score score = -this->executeNegamax(
-      1,
-      -INFINITE_SCORE,
-      -(maxScore - OPTIMAL_MOVE_THRESHOLD)
+    // results of an unfinished iteration are discarded
+    if (this->searchStopped) {
+      break;
+    }
+
+    sort(
+      iterationMoves.list, iterationMoves.last,
+      [](auto &move1, auto &move2) { return move2.score < move1.score; }
     );
 
-    MoveWithScore* last = optimalMoves.last++;
+    this->completedDepth = depth;
 
-    last->move = legalMoves.move;
-    last->score = score;
+    // next iteration searches the best moves first, then the rest in the order of this iteration's results
+    rootMoves.last = rootMoves.list;
+    optimalMoves.last = optimalMoves.list;
 
-    this->revertMove(&moveInfo);
+    for (auto &pvMove : pvMoves) {
+      rootMoves.push(pvMove);
+      optimalMoves.push(pvMove);
+    }
+
+    for (auto &iterationMove : iterationMoves) {
+      bool isPvMove = find_if(
+        pvMoves.list,
+        pvMoves.last,
+        [&iterationMove](auto &pvMove) { return pvMove.move == iterationMove.move; }
+      ) != pvMoves.last;
+
+      if (!isPvMove) {
+        rootMoves.push(iterationMove);
+      }
+    }
+
+    cout
+      << "depth " << depth << ": "
+      << utils::formatString(gameUtils::moveToUci(optimalMoves[0].move), {"red", "bold"})
+      << " (" << utils::formatString(this->getScore(optimalMoves[0].score), {"green", "bold"}) << ")"
+      << ", " << this->getElapsedTime() << " ms" << endl;
+
+    if (this->isMateScore(optimalMoves[0].score) && optimalMoves[0].score > 0) {
+      break;
+    }
+
+    // the next iteration most likely won't finish in the remaining time
+    if (!this->pondering && this->optimalTime != 0 && this->getElapsedTime() >= this->optimalTime / 2) {
+      break;
+    }
   }
 
-  sort(
-    optimalMoves.list, optimalMoves.last,
-    [](auto &move1, auto &move2) { return move2.score < move1.score; }
-  );
+  // the search was stopped from outside before the first iteration completed
+  if (optimalMoves.empty()) {
+    return rootMoves[0].move;
+  }
 
   double threshold = this->isMateScore(optimalMoves[0].score)
     ? 0.5
@@ -529,44 +1052,82 @@ string Bot::getScore(Score score) {
   return result.substr(0, result.length() - 3);
 }
 
-bool Bot::isMateScore(Score score) {
+void Bot::getTablebasePosition(TablebasePosition* position) {
+  position->colors[WHITE] = this->bitboards[WHITE][ALL_PIECES];
+  position->colors[BLACK] = this->bitboards[BLACK][ALL_PIECES];
+  position->enPassant = this->possibleEnPassant;
+  position->pliesFor50MoveRule = this->pliesFor50MoveRule;
+  position->turn = this->turn;
+
+  for (int pieceType = KING; pieceType <= PAWN; pieceType++) {
+    position->pieces[pieceType] = this->bitboards[WHITE][pieceType] | this->bitboards[BLACK][pieceType];
+  }
+}
+
+bool Bot::isMateScore(Score score) {
   return abs(score) > 1000000;
 }
 
-Move Bot::makeMove() {
+bool Bot::isSkippedDepth(int depth) {
+  if (this->threadIndex == 0) {
+    return false;
+  }
+
+  int skipIndex = (this->threadIndex - 1) % HELPER_SKIPS_COUNT;
+
+  return (depth + HELPER_SKIP_PHASES[skipIndex]) / HELPER_SKIP_SIZES[skipIndex] % 2;
+}
+
+Move Bot::makeMove(int timeLeft, int increment, int maxNodes, int deadline) {
+  if (this->ponderThread.joinable()) {
+    // the opponent hasn't replied yet
+    if (!this->ponderHit) {
+      return NO_MOVE;
+    }
+
+    cout << "ponder hit" << endl;
+
+    // the search started on the opponent's time goes on, now with the limits of our clock
+    this->ponderHitLimits = {
+      .timeLeft = timeLeft,
+      .increment = increment,
+      .maxNodes = maxNodes,
+      .deadline = deadline,
+      .start = steady_clock::now()
+    };
+    this->ponderHitLimitsReady = true;
+
+    this->ponderThread.join();
+    this->pondering = false;
+    this->ponderHit = false;
+    this->ponderHitLimitsReady = false;
+
+    // the pondered moves became moves of the game, applyMoves won't see them
+    this->resetStacks();
+
+    if (!this->ponderNodesExhausted) {
+      return this->ponderResult;
+    }
+
+    // the ponder search stopped before the hit, the move gets a search of its own on top of its table entries
+    this->prepareSearch(timeLeft, increment, maxNodes, deadline);
+
+    return this->search();
+  }
+
   if (this->color != this->turn || this->isDraw() || this->isNoMoves()) {
     return NO_MOVE;
   }
 
-  this->nodes = 0;
-  this->cutNodesCount = 0;
-  this->firstCutNodesCount = 0;
+  Move bookMove = this->getBookMove();
 
-  this->evaluatedPositions.clear();
-  this->evaluatedPawnPositions[WHITE].clear();
-  this->evaluatedPawnPositions[BLACK].clear();
+  if (bookMove != NO_MOVE) {
+    return bookMove;
+  }
 
-  clock_t timestamp = clock();
-  Move move = this->getOptimalMove();
-  double moveTook = (clock() - timestamp) * 1000.0 / CLOCKS_PER_SEC;
+  this->prepareSearch(timeLeft, increment, maxNodes, deadline);
 
-  cout << "move took " << utils::formatString(to_string((int)round(moveTook)), {"red", "bold"}) << " ms" << endl;
-  cout << "nodes: " << utils::formatString(to_string(this->nodes), {"blue", "bold"}) << endl;
-  cout << "move ordering quality: " << utils::formatString(
-    this->cutNodesCount == 0
-      ? "NaN"
-      : to_string((int)round((1.0 * this->firstCutNodesCount / this->cutNodesCount) * 100)),
-    {"green", "bold"}
-  ) << "%" << endl;
-  cout << "performance: " << utils::formatString(
-    moveTook == 0
-      ? "NaN"
-      : to_string((int)round(this->nodes / moveTook)),
-    {"green", "bold"}
-  ) << " kn/s" << endl;
-  cout << string(80, '-') << endl;
-
-  return move;
+  return this->search();
 }
 
 Score Bot::moveScore(Move move, bool isEndgame) {
@@ -588,9 +1149,11 @@ Score Bot::moveScore(Move move, bool isEndgame) {
   }
 
   if (piece->type < PAWN && piece->type > KING) {
+    Bitboard opponentPawnAttacks = this->getAttackInfo()->attacks[opponentColor][PAWN];
+
     score += (
-      (this->isControlledByOpponentPawn(from, opponentColor) ? 1000 : 0)
-      + (this->isControlledByOpponentPawn(to, opponentColor) ? -2000 : 0)
+      (opponentPawnAttacks & from ? 1000 : 0)
+      + (opponentPawnAttacks & to ? -2000 : 0)
     );
   }
 
@@ -629,3 +1192,525 @@ Score Bot::moveScore(Move move, bool isEndgame) {
 
   return Score(score);
 }
+
+Move Bot::ponder(Move move) {
+  if (this->ponderThread.joinable() || this->color != this->turn || !this->isLegalMove(move)) {
+    return NO_MOVE;
+  }
+
+  Move ponderMove = this->getPonderMove(move);
+
+  if (ponderMove == NO_MOVE) {
+    return NO_MOVE;
+  }
+
+  this->ponderMoveCount = this->moveCount;
+  this->ponderMoves[0] = move;
+  this->ponderMoves[1] = ponderMove;
+  this->ponderMoveInfos[0] = this->performMove(move);
+  this->ponderMoveInfos[1] = this->performMove(ponderMove);
+
+  if (this->isDraw() || this->isNoMoves()) {
+    this->revertMove(&this->ponderMoveInfos[1]);
+    this->revertMove(&this->ponderMoveInfos[0]);
+
+    return NO_MOVE;
+  }
+
+  if (ponderSearchesCount.fetch_add(1) >= PONDER_MAX_SEARCHES) {
+    ponderSearchesCount--;
+
+    this->revertMove(&this->ponderMoveInfos[1]);
+    this->revertMove(&this->ponderMoveInfos[0]);
+
+    return NO_MOVE;
+  }
+
+  this->prepareSearch(0, 0, 0, 0);
+
+  this->ponderHit = false;
+  this->ponderNodesExhausted = false;
+  this->pondering = true;
+  this->ponderThread = thread([this]() {
+    this->ponderResult = this->search();
+
+    ponderSearchesCount--;
+  });
+
+  return ponderMove;
+}
+
+Move Bot::pickMove(MovePicker* picker) {
+  while (true) {
+    if (picker->stage == HASH_MOVE_STAGE) {
+      picker->stage = CAPTURES_GENERATION_STAGE;
+
+      // the hash move may come from a different position with the same key bucket
+      if (picker->hashMove != NO_MOVE && this->isLegalMove(picker->hashMove)) {
+        return picker->hashMove;
+      }
+    } else if (picker->stage == CAPTURES_GENERATION_STAGE) {
+      List<Move, 256> captures(this->getAllCaptures(captures.list));
+
+      for (auto &capture : captures) {
+        MoveWithScore* last = picker->moves.last++;
+
+        last->move = capture;
+        last->score = this->captureScore(capture);
+      }
+
+      picker->stage = CAPTURES_STAGE;
+    } else if (picker->stage == CAPTURES_STAGE) {
+      Move move = this->selectNextMove(picker);
+
+      if (move == NO_MOVE) {
+        picker->stage = REFUTATIONS_STAGE;
+      } else if (this->see(move, 0)) {
+        return move;
+      } else {
+        // losing captures are tried after the quiet moves
+        picker->badCaptures.push(move);
+      }
+    } else if (picker->stage == REFUTATIONS_STAGE) {
+      if (picker->refutationIndex == picker->refutations.size()) {
+        picker->stage = QUIETS_GENERATION_STAGE;
+
+        continue;
+      }
+
+      Move* refutation = &picker->refutations[picker->refutationIndex++];
+
+      if (!this->isCaptureOrPromotion(*refutation) && this->isLegalMove(*refutation)) {
+        return *refutation;
+      }
+
+      // not searched here, so it shouldn't be skipped among quiet moves either
+      *refutation = NO_MOVE;
+    } else if (picker->stage == QUIETS_GENERATION_STAGE) {
+      List<Move, 256> quiets(this->getAllQuiets(quiets.list));
+      int (*history)[64] = this->history[this->turn];
+
+      picker->moves.last = picker->moves.list;
+      picker->current = picker->moves.list;
+
+      for (auto &quiet : quiets) {
+        if (picker->refutations.contains(quiet)) {
+          continue;
+        }
+
+        MoveWithScore* last = picker->moves.last++;
+
+        last->move = quiet;
+        last->score = Score(history[gameUtils::getMoveFrom(quiet)][gameUtils::getMoveTo(quiet)]);
+      }
+
+      picker->stage = QUIETS_STAGE;
+    } else if (picker->stage == QUIETS_STAGE) {
+      Move move = this->selectNextMove(picker);
+
+      if (move != NO_MOVE) {
+        return move;
+      }
+
+      picker->stage = BAD_CAPTURES_STAGE;
+    } else if (picker->stage == BAD_CAPTURES_STAGE) {
+      if (picker->badCaptureIndex == picker->badCaptures.size()) {
+        picker->stage = NO_MOVES_STAGE;
+
+        continue;
+      }
+
+      return picker->badCaptures[picker->badCaptureIndex++];
+    } else {
+      return NO_MOVE;
+    }
+  }
+}
+
+void Bot::prepareSearch(int timeLeft, int increment, int maxNodes, int deadline) {
+  this->searchStart = steady_clock::now();
+  this->searchStopped = false;
+  this->completedDepth = 0;
+  this->maxNodes = maxNodes;
+  this->allocateTime(timeLeft, increment, deadline);
+
+  this->nodes = 0;
+  this->searchStartNodes = 0;
+  this->cutNodesCount = 0;
+  this->firstCutNodesCount = 0;
+
+  // caches live through the whole game: older transposition entries are only replaced first,
+  // pawn entries are overwritten by colliding structures
+  this->transpositionTable->newSearch();
+
+  // killers are tied to plies of the previous search: they move up by the number of moves played since,
+  // history is only aged
+  int playedMoves = this->moveCount - this->lastSearchMoveCount;
+
+  for (int ply = 0; ply < MAX_SEARCH_DEPTH; ply++) {
+    for (int i = 0; i < 2; i++) {
+      this->killerMoves[ply][i] = playedMoves > 0 && ply + playedMoves < MAX_SEARCH_DEPTH
+        ? this->killerMoves[ply + playedMoves][i]
+        : NO_MOVE;
+    }
+  }
+
+  this->lastSearchMoveCount = this->moveCount;
+
+  for (auto &colorHistory : this->history) {
+    for (auto &fromHistory : colorHistory) {
+      for (auto &entry : fromHistory) {
+        entry /= 2;
+      }
+    }
+  }
+}
+
+// the moves are narrowed down to the ones keeping the best result, failing leaves them untouched
+bool Bot::probeRootMoves(List<Move, 256>* moves) {
+  TablebasePosition position;
+  TablebaseRootMove tablebaseMoves[256];
+  int tablebaseMovesCount;
+
+  this->getTablebasePosition(&position);
+
+  if (!this->tablebases->probeRoot(&position, tablebaseMoves, &tablebaseMovesCount)) {
+    return false;
+  }
+
+  List<Move, 256> rankedMoves;
+  int bestRank = -TABLEBASE_MAX_DTZ - 1;
+  int ranks[256];
+
+  for (int i = 0; i < tablebaseMovesCount; i++) {
+    WdlScore wdl = tablebaseMoves[i].wdl;
+    int dtz = tablebaseMoves[i].dtz;
+
+    // faster wins rank higher, wins and losses beyond the 50 move rule are almost draws
+    ranks[i] = wdl == WDL_WIN
+      ? TABLEBASE_MAX_DTZ - dtz
+      : wdl == WDL_CURSED_WIN
+        ? 1
+        : wdl == WDL_BLESSED_LOSS
+          ? -1
+          : wdl == WDL_LOSS
+            ? -TABLEBASE_MAX_DTZ + dtz
+            : 0;
+
+    if (ranks[i] > bestRank && moves->contains(tablebaseMoves[i].move)) {
+      bestRank = ranks[i];
+    }
+  }
+
+  for (int i = 0; i < tablebaseMovesCount; i++) {
+    if (ranks[i] == bestRank && moves->contains(tablebaseMoves[i].move)) {
+      rankedMoves.push(tablebaseMoves[i].move);
+    }
+  }
+
+  // the tables don't know any of the legal moves
+  if (rankedMoves.empty()) {
+    return false;
+  }
+
+  moves->last = moves->list;
+
+  for (auto &move : rankedMoves) {
+    moves->push(move);
+  }
+
+  cout << "tablebase rank " << bestRank << ", " << moves->size() << " moves left" << endl;
+
+  return true;
+}
+
+Score Bot::quiesce(int depth, Score alpha, Score beta) {
+  this->nodes++;
+  this->checkSearchLimits();
+
+  if (this->searchStopped) {
+    return SCORE_EQUAL;
+  }
+
+  if (this->isDraw()) {
+    return SCORE_EQUAL;
+  }
+
+  Score standPat = -INFINITE_SCORE;
+  List<Move, 256> moves;
+
+  if (this->checkers) {
+    // all evasions are searched when in check, standing pat is not an option
+    moves.last = this->getAllLegalMoves(moves.list);
+
+    if (moves.empty()) {
+      return this->getMateScore(depth);
+    }
+  } else {
+    standPat = this->eval(depth);
+
+    if (standPat >= beta) {
+      return beta;
+    }
+
+    // even winning a queen doesn't help
+    if (standPat + 1000 * gameUtils::piecesWorth[QUEEN] + DELTA_PRUNING_MARGIN < alpha) {
+      return alpha;
+    }
+
+    if (standPat > alpha) {
+      alpha = standPat;
+    }
+
+    moves.last = this->getAllCaptures(moves.list);
+  }
+
+  List<MoveWithScore, 256> movesWithScores;
+
+  movesWithScores.last += moves.size();
+
+  for (size_t i = 0; i < moves.size(); i++) {
+    movesWithScores[i].move = moves[i];
+    movesWithScores[i].score = this->captureScore(moves[i]);
+  }
+
+  sort(
+    movesWithScores.list,
+    movesWithScores.last,
+    [](auto &move1, auto &move2) { return move2.score < move1.score;}
+  );
+
+  for (auto &moveWithScore : movesWithScores) {
+    Piece* capturedPiece = this->board[gameUtils::getMoveTo(moveWithScore.move)];
+
+    // delta pruning: the capture can't bring the score back to alpha
+    if (
+      !this->checkers
+      && capturedPiece != this->noPiece
+      && gameUtils::getMovePromotion(moveWithScore.move) == NO_PIECE
+      && standPat + 1000 * gameUtils::piecesWorth[capturedPiece->type] + DELTA_PRUNING_MARGIN <= alpha
+    ) {
+      continue;
+    }
+
+    // captures losing material are not worth searching
+    if (!this->checkers && !this->see(moveWithScore.move, 0)) {
+      continue;
+    }
+
+    MoveInfo moveInfo = this->performMove(moveWithScore.move);
+    Score score = -this->quiesce(depth + 1, -beta, -alpha);
+
+    this->revertMove(&moveInfo);
+
+    if (this->searchStopped) {
+      return SCORE_EQUAL;
+    }
+
+    if (score >= beta) {
+      return beta;
+    }
+
+    if (score > alpha) {
+      alpha = score;
+    }
+  }
+
+  return alpha;
+}
+
+void Bot::runHelperSearch() {
+  List<Move, 256> rootMoves(this->getAllLegalMoves(rootMoves.list));
+
+  for (int depth = 1; depth <= this->maxSearchDepth && !this->searchStopped; depth++) {
+    if (this->isSkippedDepth(depth)) {
+      continue;
+    }
+
+    Score alpha = -INFINITE_SCORE;
+
+    this->searchDepth = depth;
+
+    for (size_t i = 0; i < rootMoves.size(); i++) {
+      MoveInfo moveInfo = this->performMove(rootMoves[i]);
+
+      this->moveStack[0] = rootMoves[i];
+
+      Score score = i == 0
+        ? -this->executeNegamax(1, this->searchDepth - 1, -INFINITE_SCORE, -alpha)
+        : -this->executeNegamax(1, this->searchDepth - 1, -(alpha + 1), -alpha);
+
+      if (i != 0 && score > alpha) {
+        score = -this->executeNegamax(1, this->searchDepth - 1, -INFINITE_SCORE, -alpha);
+      }
+
+      this->revertMove(&moveInfo);
+
+      if (this->searchStopped) {
+        return;
+      }
+
+      // the best move is searched first in the next iteration
+      if (score > alpha) {
+        alpha = score;
+
+        rotate(rootMoves.list, rootMoves.list + i, rootMoves.list + i + 1);
+      }
+    }
+
+    this->completedDepth = depth;
+  }
+}
+
+Score Bot::scoreFromTranspositionTable(Score score, int depth) {
+  // mate scores are stored relative to the node, not to the root
+  return this->isMateScore(score)
+    ? score > 0 ? score - depth : score + depth
+    : score;
+}
+
+Score Bot::scoreToTranspositionTable(Score score, int depth) {
+  return this->isMateScore(score)
+    ? score > 0 ? score + depth : score - depth
+    : score;
+}
+
+Move Bot::search() {
+  // lazy SMP: helpers search the same root on their own copies of the position and share the transposition table
+  vector<Bot*> helpers;
+  vector<thread> helperThreads;
+
+  // a ponder search stays on its own thread, also after a ponder hit
+  int threadCount = this->pondering ? 1 : this->threadCount;
+
+  for (int i = 1; i < threadCount; i++) {
+    Bot* helper = new Bot(*this);
+
+    helper->threadIndex = i;
+
+    helpers.push_back(helper);
+    helperThreads.emplace_back(&Bot::runHelperSearch, helper);
+  }
+
+  Move move = this->getOptimalMove();
+
+  for (auto &helper : helpers) {
+    helper->searchStopped = true;
+  }
+
+  for (auto &helperThread : helperThreads) {
+    helperThread.join();
+  }
+
+  for (auto &helper : helpers) {
+    this->nodes += helper->nodes;
+    this->cutNodesCount += helper->cutNodesCount;
+    this->firstCutNodesCount += helper->firstCutNodesCount;
+
+    delete helper;
+  }
+
+  int moveTook = this->getElapsedTime();
+
+  cout << "move took " << utils::formatString(to_string(moveTook), {"red", "bold"}) << " ms" << endl;
+  cout << "nodes: " << utils::formatString(to_string(this->nodes), {"blue", "bold"}) << endl;
+  cout << "move ordering quality: " << utils::formatString(
+    this->cutNodesCount == 0
+      ? "NaN"
+      : to_string((int)round((1.0 * this->firstCutNodesCount / this->cutNodesCount) * 100)),
+    {"green", "bold"}
+  ) << "%" << endl;
+  cout << "performance: " << utils::formatString(
+    moveTook == 0
+      ? "NaN"
+      : to_string((int)round(1.0 * this->nodes / moveTook)),
+    {"green", "bold"}
+  ) << " kn/s" << endl;
+  cout << string(80, '-') << endl;
+
+  return move;
+}
+
+Move Bot::selectNextMove(MovePicker* picker) {
+  while (picker->current != picker->moves.last) {
+    // partial selection sort: only the moves that are actually searched get sorted
+    MoveWithScore* best = max_element(
+      picker->current,
+      picker->moves.last,
+      [](auto &move1, auto &move2) { return move1.score < move2.score; }
+    );
+
+    swap(*picker->current, *best);
+
+    Move move = (picker->current++)->move;
+
+    if (move != picker->hashMove) {
+      return move;
+    }
+  }
+
+  return NO_MOVE;
+}
+
+void Bot::stop() {
+  this->stopRequested = true;
+  this->searchStopped = true;
+}
+
+void Bot::stopPondering() {
+  this->searchStopped = true;
+  this->ponderThread.join();
+
+  this->pondering = false;
+  this->ponderHit = false;
+  this->ponderHitLimitsReady = false;
+
+  this->revertMove(&this->ponderMoveInfos[1]);
+  this->revertMove(&this->ponderMoveInfos[0]);
+}
+
+Score Bot::traceEval(EvalTrace* trace) {
+  this->trace = trace;
+
+  Score score = this->evalStatic();
+
+  this->trace = nullptr;
+
+  // the trace counts white's weights positively
+  return this->turn == WHITE ? score : -score;
+}
+
+inline void Bot::traceWeight(int weight, Color color, int count) {
+  if (this->trace) {
+    this->trace->coefficients[weight] += color == WHITE ? count : -count;
+  }
+}
+
+void Bot::updateHistory(Move move, int bonus) {
+  int* entry = &this->history[this->turn][gameUtils::getMoveFrom(move)][gameUtils::getMoveTo(move)];
+
+  // the entry saturates towards HISTORY_MAX instead of growing without bound
+  *entry += bonus - *entry * abs(bonus) / HISTORY_MAX;
+}
+
+void Bot::updateQuietMoveStats(Move move, int depth, int remainingDepth, List<Move, 256>* quietMoves) {
+  Move* killers = this->killerMoves[depth];
+  Move previousMove = this->moveStack[depth - 1];
+  int bonus = min(remainingDepth * remainingDepth, 400);
+
+  if (killers[0] != move) {
+    killers[1] = killers[0];
+    killers[0] = move;
+  }
+
+  if (previousMove != NO_MOVE) {
+    this->counterMoves[gameUtils::getMoveFrom(previousMove)][gameUtils::getMoveTo(previousMove)] = move;
+  }
+
+  this->updateHistory(move, bonus);
+
+  // quiet moves that were searched before and didn't cut off are penalized
+  for (auto &quietMove : *quietMoves) {
+    this->updateHistory(quietMove, -bonus);
+  }
+}
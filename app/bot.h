@@ -1,42 +1,143 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <ctime>
 #include <string>
-#include <unordered_map>
+#include <thread>
 #include <vector>
 
+#include "evalWeights.h"
 #include "game.h"
 #include "gameUtils.h"
+#include "openingBook.h"
+#include "pawnTable.h"
+#include "tablebases.h"
+#include "transpositionTable.h"
 
 #ifndef BOT_INCLUDED
 #define BOT_INCLUDED
 
 using namespace std;
 
+const int MAX_SEARCH_DEPTH = 128;
+
+enum MovePickerStage {
+  HASH_MOVE_STAGE,
+  CAPTURES_GENERATION_STAGE,
+  CAPTURES_STAGE,
+  REFUTATIONS_STAGE,
+  QUIETS_GENERATION_STAGE,
+  QUIETS_STAGE,
+  BAD_CAPTURES_STAGE,
+  NO_MOVES_STAGE
+};
+
+// limits of a ponder hit, applied by the searching thread itself
+struct PonderHitLimits {
+  int                              timeLeft = 0;
+  int                              increment = 0;
+  int                              maxNodes = 0;
+  int                              deadline = 0;
+  chrono::steady_clock::time_point start;
+};
+
+struct MovePicker {
+  MovePickerStage          stage = HASH_MOVE_STAGE;
+  Move                     hashMove = NO_MOVE;
+  List<Move, 3>            refutations;
+  size_t                   refutationIndex = 0;
+  List<MoveWithScore, 256> moves;
+  MoveWithScore*           current = moves.list;
+  List<Move, 256>          badCaptures;
+  size_t                   badCaptureIndex = 0;
+};
+
 class Bot : public Game {
 public:
-  Bot(const string &fen, Color color, int searchDepth);
-  Move makeMove();
+  Bot(const string &fen, Color color, int maxSearchDepth, int transpositionTableSize, int threadCount, const string &tablebasesPath, const string &bookPath, const string &nnuePath);
+  Bot(const Bot &bot);
+  ~Bot();
+  void  applyMoves(const string &moves);
+  void  clearStopRequest();
+  Move  makeMove(int timeLeft, int increment, int maxNodes, int deadline);
+  Move  ponder(Move move);
+  void  stop();
+  Score traceEval(EvalTrace* trace);
 
 protected:
   Color                            color;
+  int                              completedDepth = 0;
   int                              cutNodesCount = 0;
-  unordered_map<ZobristKey, Score> evaluatedPawnPositions[2];
-  unordered_map<ZobristKey, Score> evaluatedPositions;
+  Move                             counterMoves[64][64] = {};
   int                              firstCutNodesCount = 0;
-  int                              nodes = 0;
-  int                              searchDepth;
+  int                              history[2][64][64] = {};
+  Move                             killerMoves[MAX_SEARCH_DEPTH][2] = {};
+  int                              lastSearchMoveCount = 0;
+  int                              maximumTime = 0;
+  int                              maxNodes = 0;
+  int                              maxSearchDepth;
+  Move                             moveStack[MAX_SEARCH_DEPTH];
+  int64_t                          nodes = 0;
+  OpeningBook*                     openingBook;
+  int                              optimalTime = 0;
+  PawnTable*                       pawnTable;
+  atomic<bool>                     pondering = false;
+  bool                             ponderHit = false;
+  PonderHitLimits                  ponderHitLimits;
+  atomic<bool>                     ponderHitLimitsReady = false;
+  int                              ponderMoveCount = 0;
+  MoveInfo                         ponderMoveInfos[2];
+  Move                             ponderMoves[2] = {};
+  bool                             ponderNodesExhausted = false;
+  Move                             ponderResult = NO_MOVE;
+  thread                           ponderThread;
+  int                              searchDepth = 0;
+  chrono::steady_clock::time_point searchStart;
+  int64_t                          searchStartNodes = 0;
+  atomic<bool>                     searchStopped = false;
+  atomic<bool>                     stopRequested = false;
+  Tablebases*                      tablebases;
+  int                              threadCount;
+  int                              threadIndex = 0;
+  EvalTrace*                       trace = nullptr;
+  TranspositionTable*              transpositionTable;
 
+  void      allocateTime(int timeLeft, int increment, int deadline);
+  Score     aspirationSearch(Score previousScore);
+  Score     captureScore(Move move);
+  void      checkSearchLimits();
   Score     eval(int depth);
-  Score     evalColor(Color color, PositionInfo* positionInfo);
+  Score     evalColor(Color color, PawnEntry* pawnEntry);
   Score     evalKingSafety(Color color);
-  Score     evalPawns(Color color, PositionInfo* positionInfo);
-  Score     evalPieces(Color color, PositionInfo* positionInfo);
-  Score     executeNegamax(int depth, Score alpha, Score beta);
-  PieceType getLeastWorthAttacker(Bitboard* attackers, Color color);
+  void      evalPawnStructure(PawnEntry* pawnEntry);
+  Score     evalPawns(Color color, PawnEntry* pawnEntry);
+  Score     evalPieces(Color color, PawnEntry* pawnEntry);
+  Score     evalStatic();
+  int       evalWeight(EvalWeight weight, Color color, int count = 1);
+  Score     executeNegamax(int depth, int remainingDepth, Score alpha, Score beta);
+  Move      getBookMove();
+  int       getElapsedTime();
   Score     getMateScore(int depth);
   Move      getOptimalMove();
+  Move      getPonderMove(Move move);
   string    getScore(Score score);
+  void      getTablebasePosition(TablebasePosition* position);
   bool      isMateScore(Score score);
+  bool      isSkippedDepth(int depth);
   Score     moveScore(Move move, bool isEndgame);
+  Move      pickMove(MovePicker* picker);
+  void      prepareSearch(int timeLeft, int increment, int maxNodes, int deadline);
+  bool      probeRootMoves(List<Move, 256>* moves);
+  Score     quiesce(int depth, Score alpha, Score beta);
+  void      runHelperSearch();
+  Score     scoreFromTranspositionTable(Score score, int depth);
+  Score     scoreToTranspositionTable(Score score, int depth);
+  Move      search();
+  Move      selectNextMove(MovePicker* picker);
+  void      stopPondering();
+  void      traceWeight(int weight, Color color, int count);
+  void      updateHistory(Move move, int bonus);
+  void      updateQuietMoveStats(Move move, int depth, int remainingDepth, List<Move, 256>* quietMoves);
 };
 
 #endif // BOT_INCLUDED
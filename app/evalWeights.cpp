@@ -0,0 +1,156 @@
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+
+#include "evalWeights.h"
+#include "gameUtils.h"
+
+using namespace std;
+
+int evalWeights::weights[SCALAR_EVAL_WEIGHTS_COUNT] = {
+  // king safety
+  -3000, -2000, -1000, -750, -500, -250, -100, 100, 100, 50, 50, 25,
+
+  // pawns
+  -300, 500, 200, 500, 1000, -200,
+
+  // pieces
+  -300, -300, -1000, 100, 100, 50, 25, 20, 10, 20, 150, 50, 500
+};
+
+const string scalarWeightNames[SCALAR_EVAL_WEIGHTS_COUNT] = {
+  "kingBeyondRank4",
+  "kingOnRank4",
+  "kingOnRank3",
+  "kingOnRank2Center",
+  "kingOnRank2NearCenter",
+  "kingOnCenterFile",
+  "kingOnFFile",
+  "kingCastled",
+  "kingShieldPawn",
+  "kingShieldPiece",
+  "kingSidePawn",
+  "kingSidePiece",
+
+  "doubledPawns",
+  "passedPawn",
+  "passedPawnRank5",
+  "passedPawnRank6",
+  "passedPawnRank7",
+  "pawnIsland",
+
+  "undevelopedMinor",
+  "centerPawnUnmoved",
+  "centerPawnBlocked",
+  "rookSemiOpenFile",
+  "rookOpenFile",
+  "centerControl",
+  "aroundCenterControl",
+  "opponentSideControl",
+  "otherControl",
+  "endgameMobility",
+  "kingRingAttack",
+  "kingOuterRingAttack",
+  "bishopPair"
+};
+
+const string pieceNames[6] = {"king", "queen", "rook", "bishop", "knight", "pawn"};
+
+int evalWeights::getPieceSquareWeight(Color color, PieceType pieceType, bool isEndgame, Square square) {
+  // tables are written from white's side with the 8th rank first, black reads them mirrored
+  int index = color == WHITE ? square ^ 56 : square;
+
+  return pieceType == KING && isEndgame
+    ? EG_KING_SQUARE_WEIGHTS + index
+    : MG_PIECE_SQUARE_WEIGHTS + pieceType * 64 + index;
+}
+
+int* evalWeights::getWeight(int weight) {
+  if (weight < MG_PIECE_SQUARE_WEIGHTS) {
+    return &evalWeights::weights[weight];
+  }
+
+  if (weight < EG_KING_SQUARE_WEIGHTS) {
+    int index = weight - MG_PIECE_SQUARE_WEIGHTS;
+
+    return &gameUtils::mgWhitePieceSquareTables[index / 64][index % 64];
+  }
+
+  return &gameUtils::egWhiteKingPieceSquareTable[weight - EG_KING_SQUARE_WEIGHTS];
+}
+
+string evalWeights::getWeightName(int weight) {
+  if (weight < MG_PIECE_SQUARE_WEIGHTS) {
+    return scalarWeightNames[weight];
+  }
+
+  // squares are named from white's side
+  if (weight < EG_KING_SQUARE_WEIGHTS) {
+    int index = weight - MG_PIECE_SQUARE_WEIGHTS;
+
+    return "pieceSquare." + pieceNames[index / 64] + "." + gameUtils::squareToLiteral(Square(index % 64 ^ 56));
+  }
+
+  return "endgameKingSquare." + gameUtils::squareToLiteral(Square((weight - EG_KING_SQUARE_WEIGHTS) ^ 56));
+}
+
+// one "name value" pair per line, weights missing from the file keep their built-in values
+bool evalWeights::load(const string &path) {
+  ifstream file(path);
+
+  if (!file) {
+    cerr << "eval weights " << path << " not found" << endl;
+
+    return false;
+  }
+
+  unordered_map<string, int> weightIndexes;
+
+  for (int weight = 0; weight < EVAL_WEIGHTS_COUNT; weight++) {
+    weightIndexes[evalWeights::getWeightName(weight)] = weight;
+  }
+
+  string name;
+  int value;
+  int loadedCount = 0;
+
+  while (file >> name >> value) {
+    auto weightIndex = weightIndexes.find(name);
+
+    if (weightIndex == weightIndexes.end()) {
+      cerr << "unknown eval weight " << name << " in " << path << endl;
+
+      continue;
+    }
+
+    *evalWeights::getWeight(weightIndex->second) = value;
+    loadedCount++;
+  }
+
+  if (!file.eof()) {
+    cerr << "corrupt eval weights " << path << endl;
+
+    return false;
+  }
+
+  cout << "loaded " << loadedCount << " eval weights from " << path << endl;
+
+  return true;
+}
+
+bool evalWeights::save(const string &path) {
+  ofstream file(path);
+
+  for (int weight = 0; weight < EVAL_WEIGHTS_COUNT; weight++) {
+    file << evalWeights::getWeightName(weight) << " " << *evalWeights::getWeight(weight) << endl;
+  }
+
+  if (!file) {
+    cerr << "failed to write eval weights " << path << endl;
+
+    return false;
+  }
+
+  return true;
+}
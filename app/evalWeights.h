@@ -0,0 +1,71 @@
+#include <string>
+
+#include "gameUtils.h"
+
+#ifndef EVAL_WEIGHTS_INCLUDED
+#define EVAL_WEIGHTS_INCLUDED
+
+using namespace std;
+
+enum EvalWeight : int {
+  // king safety
+  KING_BEYOND_RANK_4,
+  KING_ON_RANK_4,
+  KING_ON_RANK_3,
+  KING_ON_RANK_2_CENTER,
+  KING_ON_RANK_2_NEAR_CENTER,
+  KING_ON_CENTER_FILE,
+  KING_ON_F_FILE,
+  KING_CASTLED,
+  KING_SHIELD_PAWN,
+  KING_SHIELD_PIECE,
+  KING_SIDE_PAWN,
+  KING_SIDE_PIECE,
+
+  // pawns
+  DOUBLED_PAWNS,
+  PASSED_PAWN,
+  PASSED_PAWN_RANK_5,
+  PASSED_PAWN_RANK_6,
+  PASSED_PAWN_RANK_7,
+  PAWN_ISLAND,
+
+  // pieces
+  UNDEVELOPED_MINOR,
+  CENTER_PAWN_UNMOVED,
+  CENTER_PAWN_BLOCKED,
+  ROOK_SEMI_OPEN_FILE,
+  ROOK_OPEN_FILE,
+  CENTER_CONTROL,
+  AROUND_CENTER_CONTROL,
+  OPPONENT_SIDE_CONTROL,
+  OTHER_CONTROL,
+  ENDGAME_MOBILITY,
+  KING_RING_ATTACK,
+  KING_OUTER_RING_ATTACK,
+  BISHOP_PAIR,
+
+  SCALAR_EVAL_WEIGHTS_COUNT
+};
+
+// piece-square tables are tuned as weights too: the middlegame tables of all pieces, then the endgame king table
+const int MG_PIECE_SQUARE_WEIGHTS = SCALAR_EVAL_WEIGHTS_COUNT;
+const int EG_KING_SQUARE_WEIGHTS = MG_PIECE_SQUARE_WEIGHTS + 6 * 64;
+const int EVAL_WEIGHTS_COUNT = EG_KING_SQUARE_WEIGHTS + 64;
+
+// how many times each weight counts in an evaluation, white's minus black's
+struct EvalTrace {
+  int coefficients[EVAL_WEIGHTS_COUNT] = {};
+};
+
+namespace evalWeights {
+  extern int weights[SCALAR_EVAL_WEIGHTS_COUNT];
+
+  int    getPieceSquareWeight(Color color, PieceType pieceType, bool isEndgame, Square square);
+  int*   getWeight(int weight);
+  string getWeightName(int weight);
+  bool   load(const string &path);
+  bool   save(const string &path);
+}
+
+#endif // EVAL_WEIGHTS_INCLUDED
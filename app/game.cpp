@@ -18,13 +18,8 @@ Game::Game(const string &fen) {
     .square = NO_SQUARE
   });
 
-  this->fen = fen;
   this->turnKey = this->generateKey();
 
-  for (auto &piece : this->board) {
-    piece = this->noPiece;
-  }
-
   for (auto &castlingKey : this->castlingKeys) {
     castlingKey = this->generateKey();
   }
@@ -34,25 +29,86 @@ Game::Game(const string &fen) {
   }
 
   for (Color color = WHITE; color < NO_COLOR; ++color) {
-    this->kings[color] = this->noPiece;
-    this->material[color] = 0;
     this->pieceCounts[color] = 0;
-    this->bitboards[color][ALL_PIECES] = 0ULL;
 
     for (PieceType pieceType = KING; pieceType <= PAWN; ++pieceType) {
-      this->bitboards[color][pieceType] = 0ULL;
-
       for (Square square = SQ_A1; square < NO_SQUARE; ++square) {
         this->pieceKeys[color][pieceType][square] = this->generateKey();
       }
     }
   }
 
-  this->setStartingData();
+  this->setPosition(fen);
+}
+
+Game::Game(const Game &game) {
+  this->noPiece = new Piece(*game.noPiece);
+
+  this->bishopsCount = game.bishopsCount;
+  this->boardBitboard = game.boardBitboard;
+  this->checkers = game.checkers;
+  this->fen = game.fen;
+  this->moveCount = game.moveCount;
+  this->pawnCount = game.pawnCount;
+  this->pawnKey = game.pawnKey;
+  this->pliesFor50MoveRule = game.pliesFor50MoveRule;
+  this->positionKey = game.positionKey;
+  this->possibleCastling = game.possibleCastling;
+  this->possibleEnPassant = game.possibleEnPassant;
+  this->turn = game.turn;
+  this->turnKey = game.turnKey;
+
+  copy(begin(game.castlingKeys), end(game.castlingKeys), this->castlingKeys);
+  copy(begin(game.enPassantKeys), end(game.enPassantKeys), this->enPassantKeys);
+
+  for (auto &positionKey : game.positions) {
+    this->positions.push(positionKey);
+  }
+
+  for (auto &piece : this->board) {
+    piece = this->noPiece;
+  }
+
+  for (Color color = WHITE; color < NO_COLOR; ++color) {
+    this->kings[color] = this->noPiece;
+    this->material[color] = game.material[color];
+    this->pieceCounts[color] = game.pieceCounts[color];
+    this->pieceSquareScores[color][0] = game.pieceSquareScores[color][0];
+    this->pieceSquareScores[color][1] = game.pieceSquareScores[color][1];
+    this->bitboards[color][ALL_PIECES] = game.bitboards[color][ALL_PIECES];
+
+    for (PieceType pieceType = KING; pieceType <= PAWN; ++pieceType) {
+      this->bitboards[color][pieceType] = game.bitboards[color][pieceType];
+
+      for (Square square = SQ_A1; square < NO_SQUARE; ++square) {
+        this->pieceKeys[color][pieceType][square] = game.pieceKeys[color][pieceType][square];
+      }
+    }
+
+    for (int i = 0; i < this->pieceCounts[color]; i++) {
+      Piece* piece = this->pieces[color][i] = new Piece(*game.pieces[color][i]);
+
+      this->board[piece->square] = piece;
+
+      if (piece->type == KING) {
+        this->kings[color] = piece;
+      }
+    }
+  }
+
+  // the copy never reverts moves of the original, so its stack starts with the current position
+  if (game.nnue) {
+    this->nnue = game.nnue;
+    this->accumulators = new Accumulator[NNUE_STACK_SIZE];
+    this->accumulator = this->accumulators;
+
+    *this->accumulator = *game.accumulator;
+  }
 }
 
 Game::~Game() {
   delete this->noPiece;
+  delete[] this->accumulators;
 
   for (Color color = WHITE; color < NO_COLOR; ++color) {
     for (int i = 0; i < this->pieceCounts[color]; i++) {
@@ -61,6 +117,11 @@ Game::~Game() {
   }
 }
 
+void Game::addPieceSquareScores(Color color, PieceType pieceType, Square square) {
+  this->pieceSquareScores[color][0] += gameUtils::allPieceSquareTables[color][pieceType][0][square];
+  this->pieceSquareScores[color][1] += gameUtils::allPieceSquareTables[color][pieceType][1][square];
+}
+
 void Game::applyMoves(const string &moves) {
   if (moves.empty()) {
     return;
@@ -71,9 +132,31 @@ void Game::applyMoves(const string &moves) {
 
   newMoves.insert(newMoves.end(), split.begin() + this->moveCount, split.end());
 
+  // a long game would overflow the stacks if they were only reset once all the moves were played
   for (auto &moveString : newMoves) {
     this->performMove(gameUtils::uciToMove(moveString));
+    this->resetStacks();
+  }
+}
+
+bool Game::checkPieceSquareScores() {
+  for (Color color = WHITE; color < NO_COLOR; ++color) {
+    for (int isEndgame = 0; isEndgame < 2; isEndgame++) {
+      int score = 0;
+
+      for (int i = 0; i < this->pieceCounts[color]; i++) {
+        Piece* piece = this->pieces[color][i];
+
+        score += gameUtils::allPieceSquareTables[color][piece->type][isEndgame][piece->square];
+      }
+
+      if (score != this->pieceSquareScores[color][isEndgame]) {
+        return false;
+      }
+    }
   }
+
+  return true;
 }
 
 ZobristKey Game::generateKey() {
@@ -94,6 +177,34 @@ ZobristKey Game::generateKey() {
   return key;
 }
 
+Move* Game::getAllCaptures(Move* moves) {
+  int pieceCount = this->pieceCounts[this->turn];
+  Color opponentColor = ~this->turn;
+
+  for (int i = 0; i < pieceCount; i++) {
+    Piece* piece = this->pieces[this->turn][i];
+    bool isPawn = piece->type == PAWN;
+    bool isPawnPromotion = isPawn && gameUtils::squareRanks[piece->square] == gameUtils::ranks[piece->color][RANK_7];
+    List<Square, 32> squareList(this->getLegalMoves<false>(squareList.list, piece));
+
+    for (auto &square : squareList) {
+      Move move = gameUtils::move(piece->square, square);
+
+      // underpromotions are left to the main search
+      if (isPawnPromotion) {
+        *moves++ = move | QUEEN;
+      } else if (
+        this->board[square]->color == opponentColor
+        || (isPawn && square == this->possibleEnPassant)
+      ) {
+        *moves++ = move;
+      }
+    }
+  }
+
+  return moves;
+}
+
 Move* Game::getAllLegalMoves(Move* moves) {
   int pieceCount = this->pieceCounts[this->turn];
 
@@ -119,6 +230,82 @@ Move* Game::getAllLegalMoves(Move* moves) {
   return moves;
 }
 
+Move* Game::getAllQuiets(Move* moves) {
+  int pieceCount = this->pieceCounts[this->turn];
+
+  for (int i = 0; i < pieceCount; i++) {
+    Piece* piece = this->pieces[this->turn][i];
+    bool isPawn = piece->type == PAWN;
+    bool isPawnPromotion = isPawn && gameUtils::squareRanks[piece->square] == gameUtils::ranks[piece->color][RANK_7];
+    List<Square, 32> squareList(this->getLegalMoves<false>(squareList.list, piece));
+
+    for (auto &square : squareList) {
+      Move move = gameUtils::move(piece->square, square);
+
+      // queen promotions are generated with captures
+      if (isPawnPromotion) {
+        *moves++ = move | KNIGHT;
+        *moves++ = move | ROOK;
+        *moves++ = move | BISHOP;
+      } else if (
+        this->board[square] == this->noPiece
+        && (!isPawn || square != this->possibleEnPassant)
+      ) {
+        *moves++ = move;
+      }
+    }
+  }
+
+  return moves;
+}
+
+AttackInfo* Game::getAttackInfo() {
+  AttackInfo* attackInfo = &this->attackInfo;
+
+  if (attackInfo->key == this->positionKey) {
+    return attackInfo;
+  }
+
+  for (Color color = WHITE; color < NO_COLOR; ++color) {
+    Bitboard* attacks = attackInfo->attacks[color];
+
+    for (PieceType pieceType = KING; pieceType <= ALL_PIECES; ++pieceType) {
+      attacks[pieceType] = 0ULL;
+    }
+
+    for (int i = 0; i < this->pieceCounts[color]; i++) {
+      Piece* piece = this->pieces[color][i];
+      Bitboard pieceAttacks = attackInfo->pieceAttacks[piece->square] = this->getAttacks(piece);
+
+      attacks[piece->type] |= pieceAttacks;
+      attacks[ALL_PIECES] |= pieceAttacks;
+    }
+
+    // a piece is pinned if it's the only one between its king and an opponent slider looking at the king
+    Square kingSquare = this->kings[color]->square;
+    Color opponentColor = ~color;
+    Bitboard pinned = 0ULL;
+    Bitboard snipers = (
+      (this->getSlidingAttacks(BISHOP, kingSquare, 0ULL) & (this->bitboards[opponentColor][BISHOP] | this->bitboards[opponentColor][QUEEN]))
+      | (this->getSlidingAttacks(ROOK, kingSquare, 0ULL) & (this->bitboards[opponentColor][ROOK] | this->bitboards[opponentColor][QUEEN]))
+    );
+
+    while (snipers) {
+      Bitboard between = gameUtils::middleSquares2[kingSquare][gameUtils::popBitboardSquare(&snipers)] & this->boardBitboard;
+
+      if (between && gameUtils::isSquareBitboard(between) && (between & this->bitboards[color][ALL_PIECES])) {
+        pinned |= between;
+      }
+    }
+
+    attackInfo->pinned[color] = pinned;
+  }
+
+  attackInfo->key = this->positionKey;
+
+  return attackInfo;
+}
+
 Bitboard Game::getAttacks(Piece *piece) {
   if (piece->type == KNIGHT) {
     return gameUtils::knightAttacks2[piece->square];
@@ -147,6 +334,21 @@ Bitboard Game::getAttacksTo(Square square, Color opponentColor) {
   );
 }
 
+Bitboard Game::getAttacksTo(Square square, Bitboard occupancy) {
+  Bitboard bishops = this->bitboards[WHITE][BISHOP] | this->bitboards[BLACK][BISHOP];
+  Bitboard rooks = this->bitboards[WHITE][ROOK] | this->bitboards[BLACK][ROOK];
+  Bitboard queens = this->bitboards[WHITE][QUEEN] | this->bitboards[BLACK][QUEEN];
+
+  return (
+    (gameUtils::knightAttacks2[square] & (this->bitboards[WHITE][KNIGHT] | this->bitboards[BLACK][KNIGHT]))
+    | (gameUtils::kingAttacks2[square] & (this->bitboards[WHITE][KING] | this->bitboards[BLACK][KING]))
+    | (gameUtils::pawnAttacks2[BLACK][square] & this->bitboards[WHITE][PAWN])
+    | (gameUtils::pawnAttacks2[WHITE][square] & this->bitboards[BLACK][PAWN])
+    | (this->getSlidingAttacks(BISHOP, square, occupancy) & (bishops | queens))
+    | (this->getSlidingAttacks(ROOK, square, occupancy) & (rooks | queens))
+  );
+}
+
 template<bool stopAfter1>
 Square* Game::getLegalMoves(Square* moves, Piece *piece) {
   bool isKing = piece->type == KING;
@@ -163,12 +365,15 @@ Square* Game::getLegalMoves(Square* moves, Piece *piece) {
   bool isEnPassantPinned = false;
   PinDirection pinDirection = NO_PIN_DIRECTION;
 
-  if (
-    !isKing
-    && gameUtils::areAligned[piece->square][kingSquare]
-    && !this->isDirectionBlocked(piece->square, kingSquare)
-  ) {
-    isPinned = this->getSliderBehind(kingSquare, piece->square, opponentColor) != this->noPiece;
+  if (!isKing) {
+    // pins come for free once the position has been evaluated or its moves ordered
+    isPinned = this->attackInfo.key == this->positionKey
+      ? bool(this->attackInfo.pinned[this->turn] & piece->square)
+      : (
+        gameUtils::areAligned[piece->square][kingSquare]
+        && !this->isDirectionBlocked(piece->square, kingSquare)
+        && this->getSliderBehind(kingSquare, piece->square, opponentColor) != this->noPiece
+      );
 
     if (isPinned) {
       pinDirection = gameUtils::areAlignedDiagonally[piece->square][kingSquare]
@@ -292,6 +497,55 @@ Square* Game::getLegalMoves(Square* moves, Piece *piece) {
   return moves;
 }
 
+ZobristKey Game::getPolyglotKey() {
+  ZobristKey key = 0ULL;
+
+  for (auto &color : { WHITE, BLACK }) {
+    for (int pieceType = KING; pieceType <= PAWN; pieceType++) {
+      Bitboard pieces = this->bitboards[color][pieceType];
+      // black pawn, white pawn, black knight, ..., white king
+      int polyglotPiece = 2 * (PAWN - pieceType) + (color == WHITE);
+
+      while (pieces) {
+        key ^= gameUtils::polyglotKeys[64 * polyglotPiece + gameUtils::popBitboardSquare(&pieces)];
+      }
+    }
+  }
+
+  for (int i = 0; i < 4; i++) {
+    if (this->possibleCastling & (WHITE_OO << i)) {
+      key ^= gameUtils::polyglotKeys[768 + i];
+    }
+  }
+
+  // en passant counts only if a pawn can actually capture
+  if (
+    this->possibleEnPassant != NO_SQUARE
+    && gameUtils::pawnAttacks2[~this->turn][this->possibleEnPassant] & this->bitboards[this->turn][PAWN]
+  ) {
+    key ^= gameUtils::polyglotKeys[772 + gameUtils::fileOf(this->possibleEnPassant)];
+  }
+
+  if (this->turn == WHITE) {
+    key ^= gameUtils::polyglotKeys[780];
+  }
+
+  return key;
+}
+
+uint16_t Game::getPolyglotMove(Move move) {
+  Square from = gameUtils::getMoveFrom(move);
+  Square to = gameUtils::getMoveTo(move);
+  PieceType promotion = gameUtils::getMovePromotion(move);
+
+  // castling is encoded as the king capturing its rook
+  if (this->board[from]->type == KING && abs(gameUtils::fileOf(to) - gameUtils::fileOf(from)) == 2) {
+    to = gameUtils::square(gameUtils::rankOf(to), to > from ? FILE_H : FILE_A);
+  }
+
+  return uint16_t(to | from << 6 | (promotion == NO_PIECE ? 0 : KNIGHT + 1 - promotion) << 12);
+}
+
 Square* Game::getPseudoLegalMoves(Square* moves, Piece *piece) {
   Piece* pieceInSquare;
 
@@ -435,15 +689,34 @@ Piece* Game::getSliderBehind(Square square1, Square square2, Color color) {
 }
 
 Bitboard Game::getSlidingAttacks(PieceType pieceType, Square square) {
+  return this->getSlidingAttacks(pieceType, square, this->boardBitboard);
+}
+
+Bitboard Game::getSlidingAttacks(PieceType pieceType, Square square, Bitboard occupancy) {
   MagicAttack* magicAttack = pieceType == BISHOP
     ? &gameUtils::bishopMagicAttacks[square]
     : &gameUtils::rookMagicAttacks[square];
 
-  return magicAttack->attacks[(this->boardBitboard & magicAttack->mask) * magicAttack->magic >> magicAttack->shift];
+  return magicAttack->attacks[(occupancy & magicAttack->mask) * magicAttack->magic >> magicAttack->shift];
+}
+
+bool Game::isCapture(Move move) {
+  Square to = gameUtils::getMoveTo(move);
+
+  return (
+    this->board[to] != this->noPiece
+    || (this->board[gameUtils::getMoveFrom(move)]->type == PAWN && to == this->possibleEnPassant)
+  );
 }
 
-bool Game::isControlledByOpponentPawn(Square square, Color opponentColor) {
-  return this->bitboards[opponentColor][PAWN] & gameUtils::pawnAttacks2[~opponentColor][square];
+bool Game::isCaptureOrPromotion(Move move) {
+  Square to = gameUtils::getMoveTo(move);
+
+  return (
+    this->board[to] != this->noPiece
+    || gameUtils::getMovePromotion(move) != NO_PIECE
+    || (this->board[gameUtils::getMoveFrom(move)]->type == PAWN && to == this->possibleEnPassant)
+  );
 }
 
 bool Game::isDirectionBlocked(Square square1, Square square2) {
@@ -512,6 +785,25 @@ bool Game::isInsufficientMaterial() {
   return true;
 }
 
+bool Game::isLegalMove(Move move) {
+  Square from = gameUtils::getMoveFrom(move);
+  Piece* piece = this->board[from];
+
+  if (piece == this->noPiece || piece->color != this->turn) {
+    return false;
+  }
+
+  bool isPawnPromotion = piece->type == PAWN && gameUtils::squareRanks[from] == gameUtils::ranks[piece->color][RANK_7];
+
+  if (isPawnPromotion != (gameUtils::getMovePromotion(move) != NO_PIECE)) {
+    return false;
+  }
+
+  List<Square, 32> squareList(this->getLegalMoves<false>(squareList.list, piece));
+
+  return squareList.contains(gameUtils::getMoveTo(move));
+}
+
 bool Game::isNoMoves() {
   Piece** pieces = this->pieces[this->turn];
 
@@ -592,6 +884,9 @@ MoveInfo Game::performMove(Move move) {
 
   piece->square = to;
 
+  this->removePieceSquareScores(pieceColor, pieceType, from);
+  this->addPieceSquareScores(pieceColor, pieceType, to);
+
   if (pieceType == KING) {
     this->possibleCastling &= ~(ANY_CASTLING & pieceColor);
   } else if (pieceType == ROOK) {
@@ -641,6 +936,9 @@ MoveInfo Game::performMove(Move move) {
     this->bitboards[castlingRook->color][ALL_PIECES] ^= newRookSquare;
     this->bitboards[castlingRook->color][ROOK] ^= newRookSquare;
 
+    this->removePieceSquareScores(castlingRook->color, ROOK, castlingRook->square);
+    this->addPieceSquareScores(castlingRook->color, ROOK, newRookSquare);
+
     castlingRook->square = newRookSquare;
   }
 
@@ -650,6 +948,7 @@ MoveInfo Game::performMove(Move move) {
     (opponentPieces[capturedPiece->index] = opponentPieces[--this->pieceCounts[opponentColor]])->index = capturedPiece->index;
 
     this->material[opponentColor] -= gameUtils::piecesWorth[capturedPiece->type];
+    this->removePieceSquareScores(opponentColor, capturedPiece->type, capturedPiece->square);
     this->positionKey ^= this->pieceKeys[capturedPiece->color][capturedPiece->type][capturedPiece->square];
     this->bitboards[opponentColor][ALL_PIECES] ^= capturedPiece->square;
     this->bitboards[opponentColor][capturedPiece->type] ^= capturedPiece->square;
@@ -687,6 +986,8 @@ MoveInfo Game::performMove(Move move) {
     piece->type = promotion;
 
     this->material[pieceColor] += gameUtils::piecesWorth[promotion] - gameUtils::piecesWorth[PAWN];
+    this->removePieceSquareScores(pieceColor, PAWN, to);
+    this->addPieceSquareScores(pieceColor, promotion, to);
     this->bitboards[pieceColor][promotion] ^= to;
     this->bitboards[pieceColor][PAWN] ^= to;
     this->positionKey ^= this->pieceKeys[pieceColor][PAWN][to] ^ this->pieceKeys[pieceColor][promotion][to];
@@ -727,6 +1028,35 @@ MoveInfo Game::performMove(Move move) {
     this->positionKey ^= this->enPassantKeys[prevPossibleEnPassant];
   }
 
+  // the accumulator itself is only computed when the position is evaluated
+  if (this->nnue) {
+    Accumulator* accumulator = ++this->accumulator;
+    DirtyPiece* dirtyPiece = accumulator->dirtyPieces;
+
+    accumulator->computed[WHITE] = false;
+    accumulator->computed[BLACK] = false;
+
+    *dirtyPiece++ = {pieceColor, pieceType, from, promotion == NO_PIECE ? to : NO_SQUARE};
+
+    if (promotion != NO_PIECE) {
+      *dirtyPiece++ = {pieceColor, promotion, NO_SQUARE, to};
+    }
+
+    if (capturedPiece != this->noPiece) {
+      *dirtyPiece++ = {opponentColor, capturedPiece->type, capturedPiece->square, NO_SQUARE};
+    }
+
+    if (castlingRook != this->noPiece) {
+      Square rookSquare = gameUtils::squares
+        [gameUtils::ranks[pieceColor][RANK_1]]
+        [gameUtils::squareFiles[castlingRook->square] == FILE_F ? FILE_H : FILE_A];
+
+      *dirtyPiece++ = {pieceColor, ROOK, rookSquare, castlingRook->square};
+    }
+
+    accumulator->dirtyPiecesCount = dirtyPiece - accumulator->dirtyPieces;
+  }
+
   this->moveCount++;
   this->turn = opponentColor;
   this->checkers = this->getAttacksTo(this->kings[this->turn]->square, ~this->turn);
@@ -736,6 +1066,37 @@ MoveInfo Game::performMove(Move move) {
   return moveInfo;
 }
 
+MoveInfo Game::performNullMove() {
+  MoveInfo moveInfo = {
+    .move = NO_MOVE,
+    .movedPiece = this->noPiece,
+    .capturedPiece = this->noPiece,
+    .castlingRook = this->noPiece,
+    .prevCheckers = this->checkers,
+    .prevPositionKey = this->positionKey,
+    .prevPawnKey = this->pawnKey,
+    .prevPossibleEnPassant = this->possibleEnPassant,
+    .prevPossibleCastling = this->possibleCastling,
+    .prevPliesFor50MoveRule = this->pliesFor50MoveRule
+  };
+
+  if (this->possibleEnPassant != NO_SQUARE) {
+    this->positionKey ^= this->enPassantKeys[this->possibleEnPassant];
+    this->possibleEnPassant = NO_SQUARE;
+  }
+
+  this->positionKey ^= this->turnKey;
+
+  // positions before the null move can't be repeated after it
+  this->pliesFor50MoveRule = 0;
+  this->turn = ~this->turn;
+  this->checkers = this->getAttacksTo(this->kings[this->turn]->square, ~this->turn);
+
+  this->positions.push(this->positionKey);
+
+  return moveInfo;
+}
+
 void Game::printBoard() {
   for (Rank rank = RANK_8; rank >= RANK_1; --rank) {
     for (File file = FILE_A; file < NO_FILE; ++file) {
@@ -754,6 +1115,28 @@ void Game::printBoard() {
   }
 }
 
+void Game::removePieceSquareScores(Color color, PieceType pieceType, Square square) {
+  this->pieceSquareScores[color][0] -= gameUtils::allPieceSquareTables[color][pieceType][0][square];
+  this->pieceSquareScores[color][1] -= gameUtils::allPieceSquareTables[color][pieceType][1][square];
+}
+
+// moves of the game are never reverted, so the stacks only have to hold the current position and the search.
+// repetitions only count since the last zeroing move, and not at all once the 50 move rule is reached
+void Game::resetStacks() {
+  size_t positionsCount = min(this->positions.size(), size_t(min(this->pliesFor50MoveRule, 100) + 1));
+
+  if (positionsCount < this->positions.size()) {
+    copy(this->positions.end() - positionsCount, this->positions.end(), this->positions.list);
+
+    this->positions.last = this->positions.list + positionsCount;
+  }
+
+  if (this->nnue) {
+    *this->accumulators = *this->accumulator;
+    this->accumulator = this->accumulators;
+  }
+}
+
 void Game::revertMove(MoveInfo* move) {
   Piece* movedPiece = move->movedPiece;
   Piece* capturedPiece = move->capturedPiece;
@@ -761,6 +1144,9 @@ void Game::revertMove(MoveInfo* move) {
   Square from = gameUtils::getMoveFrom(move->move);
   PieceType promotion = gameUtils::getMovePromotion(move->move);
 
+  this->removePieceSquareScores(movedPiece->color, movedPiece->type, movedPiece->square);
+  this->addPieceSquareScores(movedPiece->color, movedPiece->type, from);
+
   this->board[movedPiece->square] = this->noPiece;
   this->boardBitboard ^= movedPiece->square;
   this->bitboards[movedPiece->color][ALL_PIECES] ^= movedPiece->square;
@@ -780,6 +1166,7 @@ void Game::revertMove(MoveInfo* move) {
     opponentPieces[capturedPiece->index] = capturedPiece;
 
     this->material[capturedPiece->color] += gameUtils::piecesWorth[capturedPiece->type];
+    this->addPieceSquareScores(capturedPiece->color, capturedPiece->type, capturedPiece->square);
     this->board[capturedPiece->square] = capturedPiece;
     this->boardBitboard |= capturedPiece->square;
     this->bitboards[capturedPiece->color][ALL_PIECES] |= capturedPiece->square;
@@ -794,6 +1181,8 @@ void Game::revertMove(MoveInfo* move) {
 
   if (promotion != NO_PIECE) {
     this->material[movedPiece->color] -= gameUtils::piecesWorth[promotion] - gameUtils::piecesWorth[PAWN];
+    this->removePieceSquareScores(movedPiece->color, promotion, from);
+    this->addPieceSquareScores(movedPiece->color, PAWN, from);
     this->bitboards[movedPiece->color][promotion] ^= movedPiece->square;
     this->bitboards[movedPiece->color][PAWN] ^= movedPiece->square;
     movedPiece->type = PAWN;
@@ -815,6 +1204,9 @@ void Game::revertMove(MoveInfo* move) {
     this->bitboards[castlingRook->color][ALL_PIECES] ^= oldSquare;
     this->bitboards[castlingRook->color][ROOK] ^= oldSquare;
 
+    this->removePieceSquareScores(castlingRook->color, ROOK, castlingRook->square);
+    this->addPieceSquareScores(castlingRook->color, ROOK, oldSquare);
+
     castlingRook->square = oldSquare;
   }
 
@@ -828,6 +1220,228 @@ void Game::revertMove(MoveInfo* move) {
   this->pliesFor50MoveRule = move->prevPliesFor50MoveRule;
   this->turn = ~this->turn;
   this->moveCount--;
+
+  if (this->nnue) {
+    this->accumulator--;
+  }
+}
+
+void Game::revertNullMove(MoveInfo* move) {
+  this->positions.pop();
+
+  this->checkers = move->prevCheckers;
+  this->positionKey = move->prevPositionKey;
+  this->possibleEnPassant = move->prevPossibleEnPassant;
+  this->pliesFor50MoveRule = move->prevPliesFor50MoveRule;
+  this->turn = ~this->turn;
+}
+
+Move Game::sanToMove(const string &san) {
+  string notation = san.substr(0, san.find_first_of("+#!?"));
+  List<Move, 256> legalMoves(this->getAllLegalMoves(legalMoves.list));
+
+  if (notation == "O-O" || notation == "0-0" || notation == "O-O-O" || notation == "0-0-0") {
+    Square from = this->kings[this->turn]->square;
+    Move move = gameUtils::move(from, gameUtils::square(gameUtils::rankOf(from), notation.length() == 3 ? FILE_G : FILE_C));
+
+    return legalMoves.contains(move) ? move : NO_MOVE;
+  }
+
+  PieceType pieceType = PAWN;
+  PieceType promotion = NO_PIECE;
+
+  if (!notation.empty() && string("KQRBN").find(notation[0]) != string::npos) {
+    pieceType = PieceType(gameUtils::pieces.find(char(tolower(notation[0]))));
+    notation = notation.substr(1);
+  }
+
+  if (!notation.empty() && string("QRBN").find(notation.back()) != string::npos) {
+    promotion = PieceType(gameUtils::pieces.find(char(tolower(notation.back()))));
+    notation.pop_back();
+  }
+
+  notation.erase(remove_if(notation.begin(), notation.end(), [](char c) { return c == 'x' || c == '='; }), notation.end());
+
+  if (notation.length() < 2 || notation.length() > 4) {
+    return NO_MOVE;
+  }
+
+  Square to = gameUtils::literalToSquare(notation.substr(notation.length() - 2));
+  // the origin file, rank or square, if the destination alone is ambiguous
+  string disambiguation = notation.substr(0, notation.length() - 2);
+  Move result = NO_MOVE;
+
+  for (auto &move : legalMoves) {
+    Square from = gameUtils::getMoveFrom(move);
+    string fromLiteral = gameUtils::squareToLiteral(from);
+
+    if (
+      gameUtils::getMoveTo(move) != to
+      || this->board[from]->type != pieceType
+      || gameUtils::getMovePromotion(move) != promotion
+      || any_of(disambiguation.begin(), disambiguation.end(), [&fromLiteral](char c) {
+        return fromLiteral.find(c) == string::npos;
+      })
+    ) {
+      continue;
+    }
+
+    // still ambiguous
+    if (result != NO_MOVE) {
+      return NO_MOVE;
+    }
+
+    result = move;
+  }
+
+  return result;
+}
+
+bool Game::see(Move move, int threshold) {
+  Square from = gameUtils::getMoveFrom(move);
+  Square to = gameUtils::getMoveTo(move);
+  Piece* piece = this->board[from];
+
+  // promotions and en passant are always considered even exchanges
+  if (
+    gameUtils::getMovePromotion(move) != NO_PIECE
+    || (piece->type == PAWN && to == this->possibleEnPassant)
+  ) {
+    return threshold <= 0;
+  }
+
+  Piece* capturedPiece = this->board[to];
+  int swap = (capturedPiece == this->noPiece ? 0 : gameUtils::piecesWorth[capturedPiece->type]) - threshold;
+
+  if (swap < 0) {
+    return false;
+  }
+
+  // even if the moved piece is lost, the threshold is still met
+  swap = gameUtils::piecesWorth[piece->type] - swap;
+
+  if (swap <= 0) {
+    return true;
+  }
+
+  // an opponent that sees neither square can't recapture, not even through the moved piece
+  if (
+    this->attackInfo.key == this->positionKey
+    && !(this->attackInfo.attacks[~this->turn][ALL_PIECES] & (gameUtils::squareBitboards[from] | gameUtils::squareBitboards[to]))
+  ) {
+    return true;
+  }
+
+  Bitboard occupancy = this->boardBitboard ^ from ^ to;
+  Bitboard attackers = this->getAttacksTo(to, occupancy);
+  Bitboard bishops = this->bitboards[WHITE][BISHOP] | this->bitboards[BLACK][BISHOP];
+  Bitboard rooks = this->bitboards[WHITE][ROOK] | this->bitboards[BLACK][ROOK];
+  Bitboard queens = this->bitboards[WHITE][QUEEN] | this->bitboards[BLACK][QUEEN];
+  Color color = this->turn;
+  bool result = true;
+
+  while (true) {
+    color = ~color;
+    attackers &= occupancy;
+
+    Bitboard colorAttackers = attackers & this->bitboards[color][ALL_PIECES];
+
+    if (!colorAttackers) {
+      break;
+    }
+
+    result = !result;
+
+    PieceType attackerType = PAWN;
+    Bitboard attacker;
+
+    // least valuable attacker first
+    for (auto &pieceType : {PAWN, KNIGHT, BISHOP, ROOK, QUEEN, KING}) {
+      attacker = colorAttackers & this->bitboards[color][pieceType];
+
+      if (attacker) {
+        attackerType = pieceType;
+
+        break;
+      }
+    }
+
+    // capturing with the king is only possible if the opponent has no attackers left
+    if (attackerType == KING) {
+      return (attackers & this->bitboards[~color][ALL_PIECES]) ? !result : result;
+    }
+
+    swap = gameUtils::piecesWorth[attackerType] - swap;
+
+    if (swap < result) {
+      break;
+    }
+
+    occupancy ^= gameUtils::getBitboardSquare(attacker);
+
+    // add x-ray attackers revealed behind the captured slider
+    if (attackerType == PAWN || attackerType == BISHOP || attackerType == QUEEN) {
+      attackers |= this->getSlidingAttacks(BISHOP, to, occupancy) & (bishops | queens);
+    }
+
+    if (attackerType == ROOK || attackerType == QUEEN) {
+      attackers |= this->getSlidingAttacks(ROOK, to, occupancy) & (rooks | queens);
+    }
+  }
+
+  return result;
+}
+
+void Game::setNnue(Nnue* nnue) {
+  if (!nnue) {
+    return;
+  }
+
+  this->nnue = nnue;
+  this->accumulators = new Accumulator[NNUE_STACK_SIZE];
+  this->accumulator = this->accumulators;
+}
+
+// the zobrist keys stay, so a game can be reused for many positions
+void Game::setPosition(const string &fen) {
+  for (Color color = WHITE; color < NO_COLOR; ++color) {
+    for (int i = 0; i < this->pieceCounts[color]; i++) {
+      delete this->pieces[color][i];
+    }
+
+    this->kings[color] = this->noPiece;
+    this->material[color] = 0;
+    this->pieceCounts[color] = 0;
+    this->pieceSquareScores[color][0] = 0;
+    this->pieceSquareScores[color][1] = 0;
+
+    for (auto &bitboard : this->bitboards[color]) {
+      bitboard = 0ULL;
+    }
+  }
+
+  for (auto &piece : this->board) {
+    piece = this->noPiece;
+  }
+
+  this->fen = fen;
+  this->bishopsCount = 0;
+  this->boardBitboard = 0ULL;
+  this->moveCount = 0;
+  this->pawnCount = 0;
+  this->pawnKey = 0ULL;
+  this->positionKey = 0ULL;
+  this->positions.last = this->positions.list;
+  this->possibleCastling = NO_CASTLING;
+  this->possibleEnPassant = NO_SQUARE;
+
+  if (this->nnue) {
+    this->accumulator = this->accumulators;
+    this->accumulator->computed[WHITE] = false;
+    this->accumulator->computed[BLACK] = false;
+  }
+
+  this->setStartingData();
 }
 
 void Game::setStartingData() {
@@ -854,6 +1468,7 @@ void Game::setStartingData() {
     this->bitboards[color][pieceType] ^= square;
     this->pieces[color][index] = piece;
     this->positionKey ^= this->pieceKeys[color][pieceType][square];
+    this->addPieceSquareScores(color, pieceType, square);
 
     if (pieceType == KING) {
       this->kings[color] = piece;
@@ -918,3 +1533,63 @@ void Game::setStartingData() {
 
   *this->positions.last++ = this->positionKey;
 }
+
+void Game::updateAccumulator(Color perspective) {
+  Accumulator* state = this->accumulator;
+  Square kingSquare = this->kings[perspective]->square;
+
+  // walk back to the last computed accumulator: a king move on the way changes every feature of its side
+  while (!state->computed[perspective]) {
+    bool isKingMoved = any_of(state->dirtyPieces, state->dirtyPieces + state->dirtyPiecesCount, [perspective](auto &dirtyPiece) {
+      return dirtyPiece.type == KING && dirtyPiece.color == perspective;
+    });
+
+    if (isKingMoved || state == this->accumulators) {
+      int features[32];
+      int featuresCount = 0;
+
+      for (Color color = WHITE; color < NO_COLOR; ++color) {
+        for (int i = 0; i < this->pieceCounts[color]; i++) {
+          Piece* piece = this->pieces[color][i];
+
+          if (piece->type != KING) {
+            features[featuresCount++] = Nnue::getFeature(perspective, kingSquare, color, piece->type, piece->square);
+          }
+        }
+      }
+
+      this->nnue->refresh(this->accumulator->values[perspective], features, featuresCount);
+      this->accumulator->computed[perspective] = true;
+
+      return;
+    }
+
+    state--;
+  }
+
+  for (Accumulator* next = state + 1; next <= this->accumulator; next++) {
+    int added[3];
+    int addedCount = 0;
+    int removed[3];
+    int removedCount = 0;
+
+    for (int i = 0; i < next->dirtyPiecesCount; i++) {
+      DirtyPiece* dirtyPiece = &next->dirtyPieces[i];
+
+      if (dirtyPiece->type == KING) {
+        continue;
+      }
+
+      if (dirtyPiece->from != NO_SQUARE) {
+        removed[removedCount++] = Nnue::getFeature(perspective, kingSquare, dirtyPiece->color, dirtyPiece->type, dirtyPiece->from);
+      }
+
+      if (dirtyPiece->to != NO_SQUARE) {
+        added[addedCount++] = Nnue::getFeature(perspective, kingSquare, dirtyPiece->color, dirtyPiece->type, dirtyPiece->to);
+      }
+    }
+
+    this->nnue->update(next->values[perspective], (next - 1)->values[perspective], added, addedCount, removed, removedCount);
+    next->computed[perspective] = true;
+  }
+}
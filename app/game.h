@@ -2,6 +2,7 @@
 #include <unordered_set>
 
 #include "gameUtils.h"
+#include "nnue.h"
 #include "utils.h"
 
 using namespace std;
@@ -12,13 +13,27 @@ using namespace std;
 class Game {
 public:
   explicit Game(const string &fen);
+  Game(const Game &game);
   ~Game();
-  void     applyMoves(const string &moves);
-  Move*    getAllLegalMoves(Move* moves);
-  MoveInfo performMove(Move move);
-  void     revertMove(MoveInfo* move);
+  void       applyMoves(const string &moves);
+  bool       checkPieceSquareScores();
+  Move*      getAllCaptures(Move* moves);
+  Move*      getAllLegalMoves(Move* moves);
+  Move*      getAllQuiets(Move* moves);
+  ZobristKey getPolyglotKey();
+  uint16_t   getPolyglotMove(Move move);
+  MoveInfo   performMove(Move move);
+  MoveInfo   performNullMove();
+  void       revertMove(MoveInfo* move);
+  void       revertNullMove(MoveInfo* move);
+  Move       sanToMove(const string &san);
+  bool       see(Move move, int threshold);
+  void       setPosition(const string &fen);
 
 protected:
+  Accumulator*              accumulator = nullptr;
+  Accumulator*              accumulators = nullptr;
+  AttackInfo                attackInfo;
   int                       bishopsCount = 0;
   Bitboard                  bitboards[2][7];
   Piece*                    board[64];
@@ -31,10 +46,12 @@ protected:
   Piece*                    kings[2];
   int                       material[2];
   int                       moveCount = 0;
+  Nnue*                     nnue = nullptr;
   Piece*                    noPiece = nullptr;
   int                       pawnCount = 0;
   ZobristKey                pawnKey = 0ULL;
   Piece*                    pieces[2][64];
+  int                       pieceSquareScores[2][2]; // [color][isEndgame]
   int                       pieceCounts[2];
   ZobristKey                pieceKeys[2][6][64];
   int                       pliesFor50MoveRule = 0;
@@ -45,23 +62,33 @@ protected:
   Color                     turn = WHITE;
   ZobristKey                turnKey;
 
-  ZobristKey generateKey();
-  Bitboard   getAttacks(Piece* piece);
-  Bitboard   getAttacksTo(Square square, Color opponentColor);
+  void        addPieceSquareScores(Color color, PieceType pieceType, Square square);
+  ZobristKey  generateKey();
+  AttackInfo* getAttackInfo();
+  Bitboard    getAttacks(Piece* piece);
+  Bitboard    getAttacksTo(Square square, Color opponentColor);
+  Bitboard    getAttacksTo(Square square, Bitboard occupancy);
   template<bool stopAfter1>
-  Square*    getLegalMoves(Square* moves, Piece* piece);
-  Square*    getPseudoLegalMoves(Square* moves, Piece* piece);
-  Piece*     getSliderBehind(Square square1, Square square2, Color color);
-  Bitboard   getSlidingAttacks(PieceType pieceType, Square square);
-  bool       isControlledByOpponentPawn(Square square, Color opponentColor);
-  bool       isDirectionBlocked(Square square1, Square square2);
-  bool       isDraw();
-  bool       isEndgame();
-  bool       isInsufficientMaterial();
-  bool       isNoMoves();
-  bool       isSquareAttacked(Square square);
-  void       printBoard();
-  void       setStartingData();
+  Square*     getLegalMoves(Square* moves, Piece* piece);
+  Square*     getPseudoLegalMoves(Square* moves, Piece* piece);
+  Piece*      getSliderBehind(Square square1, Square square2, Color color);
+  Bitboard    getSlidingAttacks(PieceType pieceType, Square square);
+  Bitboard    getSlidingAttacks(PieceType pieceType, Square square, Bitboard occupancy);
+  bool        isDirectionBlocked(Square square1, Square square2);
+  bool        isDraw();
+  bool        isEndgame();
+  bool        isCapture(Move move);
+  bool        isCaptureOrPromotion(Move move);
+  bool        isInsufficientMaterial();
+  bool        isLegalMove(Move move);
+  bool        isNoMoves();
+  bool        isSquareAttacked(Square square);
+  void        printBoard();
+  void        removePieceSquareScores(Color color, PieceType pieceType, Square square);
+  void        resetStacks();
+  void        setNnue(Nnue* nnue);
+  void        setStartingData();
+  void        updateAccumulator(Color perspective);
 };
 
 #endif // GAME_INCLUDED
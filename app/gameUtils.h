@@ -238,6 +238,14 @@ struct MoveInfo {
   int        prevPliesFor50MoveRule;
 };
 
+// attacks of a position, filled on first use so that nodes cut before evaluation and move ordering never pay for them
+struct AttackInfo {
+  Bitboard   attacks[2][7];    // [color][pieceType], ALL_PIECES holds every square the color attacks
+  ZobristKey key = 0ULL;
+  Bitboard   pieceAttacks[64]; // by the square of the attacking piece
+  Bitboard   pinned[2];        // pieces that can only move along the line to their own king
+};
+
 typedef int PieceSquareTable[64];
 
 enum Score : int {
@@ -293,11 +301,6 @@ struct FileInfo {
   Rank max = NO_RANK;
 };
 
-struct PositionInfo {
-  FileInfo            pawnFiles[2][8];
-  List<Piece*, 64>    pawns[2];
-};
-
 struct MagicAttack {
   Bitboard     attacks[4096];
   Bitboard     magic;
@@ -358,6 +361,7 @@ namespace gameUtils {
     {+2, -1},
     {-2, -1}
   };
+  extern int                      lateMoveReductions[64][64];
   extern PieceSquareTable         mgWhitePieceSquareTables[6];
   extern vector<Square>*          middleSquares[64][64];
   extern Bitboard                 middleSquares2[64][64];
@@ -371,6 +375,8 @@ namespace gameUtils {
   extern Bitboard                 pawnAttacks2[2][64];
   const string                    pieces = "kqrbnp";
   const int                       piecesWorth[6] = {1000, 16, 8, 5, 5, 1};
+  // 768 piece-square keys, 4 castling rights, 8 en passant files and the turn, as in Polyglot books
+  extern ZobristKey               polyglotKeys[781];
   extern Bitboard                 rankBitboards[2][8];
   const Rank                      ranks[2][8] = {
     { RANK_1, RANK_2, RANK_3, RANK_4, RANK_5, RANK_6, RANK_7, RANK_8 },
@@ -1,5 +1,8 @@
+#include <cmath>
+#include <cstdlib>
 #include <iostream>
 
+#include "evalWeights.h"
 #include "gameUtils.h"
 #include "init.h"
 #include "utils.h"
@@ -7,6 +10,13 @@
 using namespace std;
 
 void init::init() {
+  // tuned weights replace the built-in ones before the piece-square tables are expanded
+  const char* evalWeightsPath = getenv("EVAL_WEIGHTS_PATH");
+
+  if (evalWeightsPath != nullptr && evalWeightsPath[0] != '\0') {
+    evalWeights::load(evalWeightsPath);
+  }
+
   for (Square square = SQ_A1; square < NO_SQUARE; ++square) {
     File file = gameUtils::squareFiles[square] = gameUtils::fileOf(square);
     Rank rank = gameUtils::squareRanks[square] = gameUtils::rankOf(square);
@@ -62,6 +72,15 @@ void init::init() {
     }
   }
 
+  // reductions grow with both the remaining depth and the move index
+  for (int depth = 0; depth < 64; depth++) {
+    for (int moveIndex = 0; moveIndex < 64; moveIndex++) {
+      gameUtils::lateMoveReductions[depth][moveIndex] = depth == 0 || moveIndex == 0
+        ? 0
+        : (int)(0.75 + log(depth) * log(moveIndex) / 2.25);
+    }
+  }
+
   for (Square square1 = SQ_A1; square1 < NO_SQUARE; ++square1) {
     for (Square square2 = SQ_A1; square2 < NO_SQUARE; ++square2) {
       for (Square square3 = SQ_A1; square3 < NO_SQUARE; ++square3) {
@@ -1,9 +1,14 @@
+#include <cstring>
 #include <iostream>
 
 // #include "bot.h"
 // #include "gameUtils.h"
+#include "bench.h"
+#include "bookBuilder.h"
 #include "init.h"
 #include "perft.h"
+#include "tablebasesTest.h"
+#include "tuner.h"
 
 using namespace std;
 
@@ -12,11 +17,19 @@ int main(int argc, char** argv) {
 
   if (argc > 1 && strcmp(argv[1], "--runPerft") == 0) {
     perft::perftMain();
+  } else if (argc > 1 && strcmp(argv[1], "--runBench") == 0) {
+    bench::benchMain();
+  } else if (argc > 1 && strcmp(argv[1], "--buildBook") == 0) {
+    bookBuilder::buildBookMain(argc, argv);
+  } else if (argc > 1 && strcmp(argv[1], "--tune") == 0) {
+    tuner::tuneMain(argc, argv);
+  } else if (argc > 1 && strcmp(argv[1], "--testTablebases") == 0) {
+    return tablebasesTest::testMain(argc, argv) ? 0 : 1;
   } else {
-    // Bot bot("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", BLACK, 4 * 2);
+    // Bot bot("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", BLACK, 100, 64, 1, "", "", "");
     //
     // bot.applyMoves("e2e4");
-    // bot.makeMove();
+    // bot.makeMove(3 * 60 * 1000, 0, 0, 0);
   }
 
   return 0;
@@ -0,0 +1,275 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "gameUtils.h"
+#include "nnue.h"
+
+using namespace std;
+
+const char NNUE_MAGIC[4] = {'N', 'N', 'U', 'E'};
+const uint32_t NNUE_VERSION = 1;
+const int NNUE_CLIP = 127;
+const int NNUE_DENSE_SHIFT = 6;
+const int NNUE_OUTPUT_SCALE = 16;
+
+// int16 lanes added or subtracted by one accumulator update step
+#if defined(__AVX2__)
+const int NNUE_LANES = 16;
+#elif defined(__SSE2__)
+const int NNUE_LANES = 8;
+#else
+const int NNUE_LANES = 1;
+#endif
+
+static_assert(NNUE_HIDDEN_SIZE % 16 == 0 && NNUE_DENSE_SIZE % 16 == 0, "layer sizes must fill whole vectors");
+
+inline void addWeights(int16_t* values, const int16_t* weights) {
+  for (int i = 0; i < NNUE_HIDDEN_SIZE; i += NNUE_LANES) {
+#if defined(__AVX2__)
+    __m256i* value = (__m256i*)(values + i);
+
+    _mm256_storeu_si256(value, _mm256_add_epi16(_mm256_loadu_si256(value), _mm256_loadu_si256((const __m256i*)(weights + i))));
+#elif defined(__SSE2__)
+    __m128i* value = (__m128i*)(values + i);
+
+    _mm_storeu_si128(value, _mm_add_epi16(_mm_loadu_si128(value), _mm_loadu_si128((const __m128i*)(weights + i))));
+#else
+    values[i] += weights[i];
+#endif
+  }
+}
+
+inline void subtractWeights(int16_t* values, const int16_t* weights) {
+  for (int i = 0; i < NNUE_HIDDEN_SIZE; i += NNUE_LANES) {
+#if defined(__AVX2__)
+    __m256i* value = (__m256i*)(values + i);
+
+    _mm256_storeu_si256(value, _mm256_sub_epi16(_mm256_loadu_si256(value), _mm256_loadu_si256((const __m256i*)(weights + i))));
+#elif defined(__SSE2__)
+    __m128i* value = (__m128i*)(values + i);
+
+    _mm_storeu_si128(value, _mm_sub_epi16(_mm_loadu_si128(value), _mm_loadu_si128((const __m128i*)(weights + i))));
+#else
+    values[i] -= weights[i];
+#endif
+  }
+}
+
+inline void clipAccumulator(int16_t* output, const int16_t* values) {
+  for (int i = 0; i < NNUE_HIDDEN_SIZE; i += NNUE_LANES) {
+#if defined(__AVX2__)
+    __m256i value = _mm256_loadu_si256((const __m256i*)(values + i));
+
+    value = _mm256_min_epi16(_mm256_max_epi16(value, _mm256_setzero_si256()), _mm256_set1_epi16(NNUE_CLIP));
+
+    _mm256_storeu_si256((__m256i*)(output + i), value);
+#elif defined(__SSE2__)
+    __m128i value = _mm_loadu_si128((const __m128i*)(values + i));
+
+    value = _mm_min_epi16(_mm_max_epi16(value, _mm_setzero_si128()), _mm_set1_epi16(NNUE_CLIP));
+
+    _mm_storeu_si128((__m128i*)(output + i), value);
+#else
+    output[i] = clamp(values[i], int16_t(0), int16_t(NNUE_CLIP));
+#endif
+  }
+}
+
+// inputs are clipped to 0..127, so pairwise int16 products summed into int32 lanes can't overflow
+inline int32_t dotProduct(const int16_t* input, const int16_t* weights, int size) {
+#if defined(__AVX2__)
+  __m256i sum = _mm256_setzero_si256();
+
+  for (int i = 0; i < size; i += 16) {
+    sum = _mm256_add_epi32(sum, _mm256_madd_epi16(
+      _mm256_loadu_si256((const __m256i*)(input + i)),
+      _mm256_loadu_si256((const __m256i*)(weights + i))
+    ));
+  }
+
+  __m128i sum128 = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+
+  sum128 = _mm_add_epi32(sum128, _mm_shuffle_epi32(sum128, _MM_SHUFFLE(1, 0, 3, 2)));
+  sum128 = _mm_add_epi32(sum128, _mm_shuffle_epi32(sum128, _MM_SHUFFLE(2, 3, 0, 1)));
+
+  return _mm_cvtsi128_si32(sum128);
+#elif defined(__SSE2__)
+  __m128i sum = _mm_setzero_si128();
+
+  for (int i = 0; i < size; i += 8) {
+    sum = _mm_add_epi32(sum, _mm_madd_epi16(
+      _mm_loadu_si128((const __m128i*)(input + i)),
+      _mm_loadu_si128((const __m128i*)(weights + i))
+    ));
+  }
+
+  sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+  sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+
+  return _mm_cvtsi128_si32(sum);
+#else
+  int32_t sum = 0;
+
+  for (int i = 0; i < size; i++) {
+    sum += input[i] * weights[i];
+  }
+
+  return sum;
+#endif
+}
+
+template<int inputSize>
+inline void denseLayer(int16_t* output, const int16_t* input, const int16_t weights[][inputSize], const int32_t* biases) {
+  for (int i = 0; i < NNUE_DENSE_SIZE; i++) {
+    output[i] = int16_t(clamp((biases[i] + dotProduct(input, weights[i], inputSize)) >> NNUE_DENSE_SHIFT, 0, NNUE_CLIP));
+  }
+}
+
+template<typename T>
+inline bool readValues(ifstream &file, T* values, size_t count) {
+  return bool(file.read((char*)values, count * sizeof(T)));
+}
+
+Score Nnue::evaluate(Accumulator* accumulator, Color turn) {
+  alignas(64) int16_t input[2 * NNUE_HIDDEN_SIZE];
+  alignas(64) int16_t hidden1[NNUE_DENSE_SIZE];
+  alignas(64) int16_t hidden2[NNUE_DENSE_SIZE];
+
+  clipAccumulator(input, accumulator->values[turn]);
+  clipAccumulator(input + NNUE_HIDDEN_SIZE, accumulator->values[~turn]);
+
+  denseLayer<2 * NNUE_HIDDEN_SIZE>(hidden1, input, this->hidden1Weights, this->hidden1Biases);
+  denseLayer<NNUE_DENSE_SIZE>(hidden2, hidden1, this->hidden2Weights, this->hidden2Biases);
+
+  int32_t output = this->outputBias + dotProduct(hidden2, this->outputWeights, NNUE_DENSE_SIZE);
+
+  // centipawns to score units: a pawn is worth 1000
+  return Score(output * 10 / NNUE_OUTPUT_SCALE);
+}
+
+Nnue* Nnue::get(const string &path) {
+  static mutex instancesMutex;
+  static unordered_map<string, Nnue*> instances;
+
+  if (path.empty()) {
+    return nullptr;
+  }
+
+  lock_guard<mutex> lock(instancesMutex);
+  auto instance = instances.find(path);
+
+  if (instance != instances.end()) {
+    return instance->second;
+  }
+
+  // never deleted: the weights are used by every bot until the process exits.
+  // a file that failed to load is remembered too, so that the error is only reported once
+  Nnue* nnue = Nnue::load(path);
+
+  instances[path] = nnue;
+
+  return nnue;
+}
+
+int Nnue::getFeature(Color perspective, Square kingSquare, Color color, PieceType pieceType, Square square) {
+  // black sees the board flipped vertically, pieces are ordered queen to pawn, own pieces first
+  int flip = perspective == WHITE ? 0 : 56;
+  int pieceIndex = (pieceType - QUEEN) + (color == perspective ? 0 : 5);
+
+  return (kingSquare ^ flip) * NNUE_PIECE_SQUARES + 1 + pieceIndex * 64 + (square ^ flip);
+}
+
+// the file is the magic, the version and the layer sizes as uint32, followed by the biases and the weights
+// of each layer in order, little-endian. dense layer weights are stored output by output
+Nnue* Nnue::load(const string &path) {
+  ifstream file(path, ios::binary);
+
+  if (!file) {
+    cerr << "network " << path << " not found" << endl;
+
+    return nullptr;
+  }
+
+  char magic[4];
+  uint32_t header[4];
+
+  if (
+    !readValues(file, magic, 4)
+    || memcmp(magic, NNUE_MAGIC, 4) != 0
+    || !readValues(file, header, 4)
+    || header[0] != NNUE_VERSION
+    || header[1] != NNUE_FEATURE_COUNT
+    || header[2] != NNUE_HIDDEN_SIZE
+    || header[3] != NNUE_DENSE_SIZE
+  ) {
+    cerr << "unsupported network " << path << endl;
+
+    return nullptr;
+  }
+
+  Nnue* nnue = new Nnue();
+
+  nnue->featureBiases = new int16_t[NNUE_HIDDEN_SIZE];
+  nnue->featureWeights = new int16_t[(size_t)NNUE_FEATURE_COUNT * NNUE_HIDDEN_SIZE];
+
+  if (
+    !readValues(file, nnue->featureBiases, NNUE_HIDDEN_SIZE)
+    || !readValues(file, nnue->featureWeights, (size_t)NNUE_FEATURE_COUNT * NNUE_HIDDEN_SIZE)
+    || !readValues(file, nnue->hidden1Biases, NNUE_DENSE_SIZE)
+    || !readValues(file, &nnue->hidden1Weights[0][0], NNUE_DENSE_SIZE * 2 * NNUE_HIDDEN_SIZE)
+    || !readValues(file, nnue->hidden2Biases, NNUE_DENSE_SIZE)
+    || !readValues(file, &nnue->hidden2Weights[0][0], NNUE_DENSE_SIZE * NNUE_DENSE_SIZE)
+    || !readValues(file, &nnue->outputBias, 1)
+    || !readValues(file, nnue->outputWeights, NNUE_DENSE_SIZE)
+    || file.peek() != EOF
+  ) {
+    cerr << "corrupt network " << path << endl;
+
+    delete[] nnue->featureBiases;
+    delete[] nnue->featureWeights;
+    delete nnue;
+
+    return nullptr;
+  }
+
+  cout << "loaded network " << path << endl;
+
+  return nnue;
+}
+
+void Nnue::refresh(int16_t* values, const int* features, int featuresCount) {
+  copy(this->featureBiases, this->featureBiases + NNUE_HIDDEN_SIZE, values);
+
+  for (int i = 0; i < featuresCount; i++) {
+    addWeights(values, this->featureWeights + (size_t)features[i] * NNUE_HIDDEN_SIZE);
+  }
+}
+
+void Nnue::update(
+  int16_t* values,
+  const int16_t* prevValues,
+  const int* added,
+  int addedCount,
+  const int* removed,
+  int removedCount
+) {
+  copy(prevValues, prevValues + NNUE_HIDDEN_SIZE, values);
+
+  for (int i = 0; i < removedCount; i++) {
+    subtractWeights(values, this->featureWeights + (size_t)removed[i] * NNUE_HIDDEN_SIZE);
+  }
+
+  for (int i = 0; i < addedCount; i++) {
+    addWeights(values, this->featureWeights + (size_t)added[i] * NNUE_HIDDEN_SIZE);
+  }
+}
@@ -0,0 +1,61 @@
+#include <cstdint>
+#include <string>
+
+#include "gameUtils.h"
+
+#ifndef NNUE_INCLUDED
+#define NNUE_INCLUDED
+
+using namespace std;
+
+// HalfKP: a feature is a non-king piece on a square, paired with the king square of the perspective side
+const int NNUE_PIECE_SQUARES = 10 * 64 + 1;
+const int NNUE_FEATURE_COUNT = 64 * NNUE_PIECE_SQUARES;
+const int NNUE_HIDDEN_SIZE = 256;
+const int NNUE_DENSE_SIZE = 32;
+// one accumulator per position that the game and the search can hold at the same time
+const int NNUE_STACK_SIZE = 512;
+
+// a piece moved by the move leading to the position: to is NO_SQUARE if it was removed, from if it was added
+struct DirtyPiece {
+  Color     color;
+  PieceType type;
+  Square    from;
+  Square    to;
+};
+
+struct alignas(64) Accumulator {
+  int16_t    values[2][NNUE_HIDDEN_SIZE];
+  bool       computed[2] = {false, false};
+  DirtyPiece dirtyPieces[3];
+  int        dirtyPiecesCount = 0;
+};
+
+// features -> 2 x 256 (the side to move first) -> 32 -> 32 -> 1, all weights are int16.
+// activations are clipped to 0..127, dense layers are scaled down by 64 and the output by 16 to centipawns.
+// the weights are loaded once per path and shared by all bots using it
+class Nnue {
+public:
+  static Nnue* get(const string &path);
+  static int   getFeature(Color perspective, Square kingSquare, Color color, PieceType pieceType, Square square);
+
+  Score evaluate(Accumulator* accumulator, Color turn);
+  void  refresh(int16_t* values, const int* features, int featuresCount);
+  void  update(int16_t* values, const int16_t* prevValues, const int* added, int addedCount, const int* removed, int removedCount);
+
+protected:
+  Nnue() = default;
+
+  int16_t* featureBiases = nullptr;
+  int16_t* featureWeights = nullptr;
+  int32_t  hidden1Biases[NNUE_DENSE_SIZE];
+  int16_t  hidden1Weights[NNUE_DENSE_SIZE][2 * NNUE_HIDDEN_SIZE];
+  int32_t  hidden2Biases[NNUE_DENSE_SIZE];
+  int16_t  hidden2Weights[NNUE_DENSE_SIZE][NNUE_DENSE_SIZE];
+  int32_t  outputBias;
+  int16_t  outputWeights[NNUE_DENSE_SIZE];
+
+  static Nnue* load(const string &path);
+};
+
+#endif // NNUE_INCLUDED
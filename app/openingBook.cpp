@@ -0,0 +1,113 @@
+#include <fcntl.h>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+#include "openingBook.h"
+
+using namespace std;
+
+inline uint64_t readBigEndian(const uint8_t* address, int size) {
+  uint64_t value = 0;
+
+  for (int i = 0; i < size; i++) {
+    value = value << 8 | address[i];
+  }
+
+  return value;
+}
+
+OpeningBook::OpeningBook(const string &path) {
+  int fd = open(path.c_str(), O_RDONLY);
+
+  if (fd == -1) {
+    cerr << "opening book " << path << " not found" << endl;
+
+    return;
+  }
+
+  struct stat fileStat;
+
+  fstat(fd, &fileStat);
+
+  if (fileStat.st_size == 0 || fileStat.st_size % BOOK_ENTRY_SIZE != 0) {
+    cerr << "corrupt opening book " << path << endl;
+    close(fd);
+
+    return;
+  }
+
+  void* address = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+  close(fd);
+
+  if (address == MAP_FAILED) {
+    cerr << "failed to map opening book " << path << endl;
+
+    return;
+  }
+
+  madvise(address, fileStat.st_size, MADV_RANDOM);
+
+  this->data = (uint8_t*)address;
+  this->entriesCount = fileStat.st_size / BOOK_ENTRY_SIZE;
+
+  cout << "found " << this->entriesCount << " book entries in " << path << endl;
+}
+
+OpeningBook* OpeningBook::get(const string &path) {
+  static mutex instancesMutex;
+  static unordered_map<string, OpeningBook*> instances;
+
+  if (path.empty()) {
+    return nullptr;
+  }
+
+  lock_guard<mutex> lock(instancesMutex);
+  auto instance = instances.find(path);
+
+  if (instance != instances.end()) {
+    return instance->second;
+  }
+
+  // never deleted: the mapping is used by every bot until the process exits
+  OpeningBook* book = new OpeningBook(path);
+
+  instances[path] = book;
+
+  return book;
+}
+
+void OpeningBook::getEntries(ZobristKey key, vector<BookEntry>* entries) {
+  size_t low = 0;
+  size_t high = this->entriesCount;
+
+  // the first entry with the key
+  while (low < high) {
+    size_t middle = (low + high) / 2;
+
+    if (this->getKey(middle) < key) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+
+  for (size_t i = low; i < this->entriesCount && this->getKey(i) == key; i++) {
+    uint8_t* entry = this->data + i * BOOK_ENTRY_SIZE;
+
+    entries->push_back({
+      .move = uint16_t(readBigEndian(entry + 8, 2)),
+      .weight = uint16_t(readBigEndian(entry + 10, 2))
+    });
+  }
+}
+
+ZobristKey OpeningBook::getKey(size_t index) {
+  return readBigEndian(this->data + index * BOOK_ENTRY_SIZE, 8);
+}
@@ -0,0 +1,37 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "gameUtils.h"
+
+#ifndef OPENING_BOOK_INCLUDED
+#define OPENING_BOOK_INCLUDED
+
+using namespace std;
+
+const int BOOK_ENTRY_SIZE = 16;
+
+// move is encoded as to | from << 6 | promotion << 12, castling as the king capturing its rook
+struct BookEntry {
+  uint16_t move;
+  uint16_t weight;
+};
+
+// Polyglot .bin book: entries sorted by position key, stored big-endian.
+// the file is memory-mapped once and shared by all bots using the same path
+class OpeningBook {
+public:
+  static OpeningBook* get(const string &path);
+
+  void getEntries(ZobristKey key, vector<BookEntry>* entries);
+
+protected:
+  explicit OpeningBook(const string &path);
+
+  uint8_t* data = nullptr;
+  size_t   entriesCount = 0;
+
+  ZobristKey getKey(size_t index);
+};
+
+#endif // OPENING_BOOK_INCLUDED
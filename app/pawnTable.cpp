@@ -0,0 +1,21 @@
+#include <algorithm>
+
+#include "gameUtils.h"
+#include "pawnTable.h"
+
+using namespace std;
+
+PawnTable::PawnTable(int entryCount) {
+  this->entryCount = 1;
+
+  while (this->entryCount * 2 <= (size_t)max(entryCount, 1)) {
+    this->entryCount *= 2;
+  }
+
+  // an empty entry has the key of a position without pawns and holds exactly what its evaluation would
+  this->entries = new PawnEntry[this->entryCount];
+}
+
+PawnTable::~PawnTable() {
+  delete[] this->entries;
+}
@@ -0,0 +1,32 @@
+#include <cstdint>
+
+#include "gameUtils.h"
+
+#ifndef PAWN_TABLE_INCLUDED
+#define PAWN_TABLE_INCLUDED
+
+using namespace std;
+
+// everything here depends only on the pawns, so one entry serves both sides to move
+struct PawnEntry {
+  ZobristKey key = 0ULL;
+  Score      score = SCORE_EQUAL; // white's point of view
+  FileInfo   pawnFiles[2][8];
+};
+
+// direct-mapped: a new pawn structure always replaces the old one in its slot
+class PawnTable {
+public:
+  explicit PawnTable(int entryCount);
+  ~PawnTable();
+
+  inline PawnEntry* probe(ZobristKey key) {
+    return &this->entries[key & (this->entryCount - 1)];
+  };
+
+protected:
+  PawnEntry* entries;
+  size_t     entryCount;
+};
+
+#endif // PAWN_TABLE_INCLUDED
@@ -1,4 +1,5 @@
 #include <chrono>
+#include <functional>
 #include <iostream>
 #include <string>
 #include <unordered_map>
@@ -6,6 +7,7 @@
 
 #include "game.h"
 #include "gameUtils.h"
+#include "nnue.h"
 #include "perft.h"
 #include "utils.h"
 
@@ -17,6 +19,47 @@ int DEPTH = 6;
 unordered_map<string, int> realMap = {};
 bool checkPosition = false;
 bool debug = false;
+// compares the incrementally updated piece-square scores with a full recompute after every move
+bool checkIncrementalScores = false;
+
+// knight moves back and forth, 4 plies a cycle: long enough to overflow stacks that aren't reset during a game
+int LONG_GAME_CYCLES = 300;
+
+// zero weights are enough to walk the accumulator stack without a trained network
+class LongGameNnue : public Nnue {
+public:
+  LongGameNnue() {
+    this->featureBiases = new int16_t[NNUE_HIDDEN_SIZE]();
+    this->featureWeights = new int16_t[size_t(NNUE_FEATURE_COUNT) * NNUE_HIDDEN_SIZE]();
+  }
+  ~LongGameNnue() {
+    delete[] this->featureBiases;
+    delete[] this->featureWeights;
+  }
+};
+
+class LongGame : public Game {
+public:
+  explicit LongGame(Nnue* nnue) : Game(initialFen) {
+    this->setNnue(nnue);
+  }
+
+  // back to the initial position, with the stacks holding it and the positions the 50 move rule can repeat
+  bool isValid(int movesCount) {
+    List<Move, 256> legalMoves(this->getAllLegalMoves(legalMoves.list));
+
+    this->updateAccumulator(WHITE);
+    this->updateAccumulator(BLACK);
+
+    return (
+      this->moveCount == movesCount
+      && this->turn == WHITE
+      && legalMoves.size() == 20
+      && this->accumulator == this->accumulators
+      && this->positions.size() == 101
+    );
+  }
+};
 
 vector<PerfTest> tests = {
   {
@@ -94,6 +137,12 @@ int perft::perft(string initialFen, int depth, bool useMap) {
 
       MoveInfo moveInfo = game.performMove(move);
 
+      if (checkIncrementalScores && !game.checkPieceSquareScores()) {
+        cout << "piece-square scores mismatch after " << gameUtils::moveToUci(move) << ", fen: " << initialFen << endl;
+
+        exit(1);
+      }
+
       // performMoveTime += duration_cast<nanoseconds>(high_resolution_clock::now() - timestamp).count();
 
       int moveNodes = calculateNodes(depth - 1);
@@ -104,6 +153,12 @@ int perft::perft(string initialFen, int depth, bool useMap) {
 
       game.revertMove(&moveInfo);
 
+      if (checkIncrementalScores && !game.checkPieceSquareScores()) {
+        cout << "piece-square scores mismatch after reverting " << gameUtils::moveToUci(move) << ", fen: " << initialFen << endl;
+
+        exit(1);
+      }
+
       // revertMoveTime += duration_cast<nanoseconds>(high_resolution_clock::now() - timestamp).count();
 
       if (useMap && depth == DEPTH) {
@@ -163,6 +218,35 @@ int perft::perft(string initialFen, int depth, bool useMap) {
   return nodes;
 }
 
+// the whole game in one call, as when a bot joins a game late, and one move at a time, as the game goes
+bool perft::checkLongGame() {
+  LongGameNnue nnue;
+  LongGame wholeGame(&nnue);
+  LongGame movesGame(&nnue);
+  string moves;
+  int movesCount = 4 * LONG_GAME_CYCLES;
+
+  for (int i = 0; i < LONG_GAME_CYCLES; i++) {
+    moves += string(i == 0 ? "" : " ") + "g1f3 g8f6 f3g1 f6g8";
+  }
+
+  wholeGame.applyMoves(moves);
+
+  for (size_t end = moves.find(' '); end != string::npos; end = moves.find(' ', end + 1)) {
+    movesGame.applyMoves(moves.substr(0, end));
+  }
+
+  movesGame.applyMoves(moves);
+
+  if (!wholeGame.isValid(movesCount) || !movesGame.isValid(movesCount)) {
+    cout << "invalid position after a game of " << movesCount << " plies" << endl;
+
+    return false;
+  }
+
+  return true;
+}
+
 void perft::perftMain() {
   auto timestamp = high_resolution_clock::now();
   int sumNodes = 0;
@@ -172,6 +256,10 @@ void perft::perftMain() {
       perft::perft(initialFen, i, debug);
     }
   } else {
+    if (!perft::checkLongGame()) {
+      exit(1);
+    }
+
     for (auto &[initialFen, nodeCounts] : tests) {
       for (int i = 1; i <= nodeCounts.size(); i++) {
         int nodes = perft::perft(initialFen, i, false);
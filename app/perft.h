@@ -12,6 +12,7 @@ struct PerfTest {
 };
 
 namespace perft {
+  bool checkLongGame();
   int  perft(string initialFen, int depth, bool useMap);
   void perftMain();
 }
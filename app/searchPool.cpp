@@ -0,0 +1,75 @@
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "searchPool.h"
+
+using namespace std;
+
+SearchPool::SearchPool(int slotCount) {
+  this->slotCount = max(slotCount, 1);
+  this->freeSlots = this->slotCount;
+
+  // every job takes at least one slot, so there's never a need for more workers than slots
+  for (int i = 0; i < this->slotCount; i++) {
+    this->workers.emplace_back(&SearchPool::runWorker, this);
+  }
+}
+
+SearchPool::~SearchPool() {
+  {
+    lock_guard<mutex> lock(this->jobsMutex);
+
+    this->stopping = true;
+  }
+
+  this->condition.notify_all();
+
+  for (auto &worker : this->workers) {
+    worker.join();
+  }
+}
+
+int SearchPool::getSlotCount() {
+  return this->slotCount;
+}
+
+void SearchPool::push(int threadCount, const function<void()> &run) {
+  {
+    lock_guard<mutex> lock(this->jobsMutex);
+
+    // a search with more threads than the machine has cores still has to run eventually
+    this->jobs.push_back({run, min(max(threadCount, 1), this->slotCount)});
+  }
+
+  this->condition.notify_all();
+}
+
+void SearchPool::runWorker() {
+  unique_lock<mutex> lock(this->jobsMutex);
+
+  while (true) {
+    // jobs are started strictly in order: a big job at the front is not overtaken by smaller ones
+    this->condition.wait(lock, [this]() {
+      return this->stopping || (!this->jobs.empty() && this->jobs.front().slots <= this->freeSlots);
+    });
+
+    if (this->stopping) {
+      return;
+    }
+
+    SearchJob job = this->jobs.front();
+
+    this->jobs.pop_front();
+    this->freeSlots -= job.slots;
+
+    lock.unlock();
+    job.run();
+    lock.lock();
+
+    this->freeSlots += job.slots;
+    this->condition.notify_all();
+  }
+}
@@ -0,0 +1,37 @@
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifndef SEARCH_POOL_INCLUDED
+#define SEARCH_POOL_INCLUDED
+
+using namespace std;
+
+struct SearchJob {
+  function<void()> run;
+  int              slots;
+};
+
+class SearchPool {
+public:
+  explicit SearchPool(int slotCount);
+  ~SearchPool();
+  int  getSlotCount();
+  void push(int threadCount, const function<void()> &run);
+
+private:
+  condition_variable condition;
+  int                freeSlots;
+  deque<SearchJob>   jobs;
+  mutex              jobsMutex;
+  int                slotCount;
+  bool               stopping = false;
+  vector<thread>     workers;
+
+  void runWorker();
+};
+
+#endif // SEARCH_POOL_INCLUDED
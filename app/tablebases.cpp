@@ -0,0 +1,145 @@
+#include <iostream>
+#include <mutex>
+#include <string>
+
+#ifdef SYZYGY_TABLEBASES
+#include "tbprobe.h"
+#endif
+
+#include "gameUtils.h"
+#include "tablebases.h"
+
+using namespace std;
+
+Tablebases::Tablebases(int cardinality) {
+  this->cardinality = cardinality;
+}
+
+Tablebases* Tablebases::get(const string &path) {
+  static mutex instanceMutex;
+  static string instancePath;
+  static Tablebases* instance = nullptr;
+
+  if (path.empty()) {
+    return nullptr;
+  }
+
+  lock_guard<mutex> lock(instanceMutex);
+
+  // the first directory is kept, errors are only reported once
+  if (!instancePath.empty()) {
+    if (path != instancePath) {
+      cerr << "tablebases " << path << " ignored, " << instancePath << " is in use" << endl;
+    }
+
+    return path == instancePath ? instance : nullptr;
+  }
+
+  instancePath = path;
+
+#ifdef SYZYGY_TABLEBASES
+  if (!tb_init(path.c_str()) || TB_LARGEST == 0) {
+    cerr << "no tablebases found in " << path << endl;
+
+    return nullptr;
+  }
+
+  // never deleted: the tables are used by every bot until the process exits
+  instance = new Tablebases(TB_LARGEST);
+
+  cout << "loaded tablebases up to " << TB_LARGEST << " pieces from " << path << endl;
+#else
+  cerr << "tablebases " << path << " ignored, built without SYZYGY_TABLEBASES" << endl;
+#endif
+
+  return instance;
+}
+
+int Tablebases::getCardinality() {
+  return this->cardinality;
+}
+
+// the parameters are unused when built without Fathom
+bool Tablebases::probeRoot(
+  [[maybe_unused]] TablebasePosition* position,
+  [[maybe_unused]] TablebaseRootMove* moves,
+  [[maybe_unused]] int* movesCount
+) {
+#ifdef SYZYGY_TABLEBASES
+  const PieceType promotions[5] = {NO_PIECE, QUEEN, ROOK, BISHOP, KNIGHT};
+  unsigned results[TB_MAX_MOVES];
+  unsigned result;
+
+  // unlike the WDL probe, Fathom's root probe isn't thread-safe
+  {
+    lock_guard<mutex> lock(this->rootMutex);
+
+    result = tb_probe_root(
+      position->colors[WHITE],
+      position->colors[BLACK],
+      position->pieces[KING],
+      position->pieces[QUEEN],
+      position->pieces[ROOK],
+      position->pieces[BISHOP],
+      position->pieces[KNIGHT],
+      position->pieces[PAWN],
+      position->pliesFor50MoveRule,
+      0,
+      position->enPassant == NO_SQUARE ? 0 : position->enPassant,
+      position->turn == WHITE,
+      results
+    );
+  }
+
+  if (result == TB_RESULT_FAILED || result == TB_RESULT_CHECKMATE || result == TB_RESULT_STALEMATE) {
+    return false;
+  }
+
+  *movesCount = 0;
+
+  for (unsigned* moveResult = results; *moveResult != TB_RESULT_FAILED; moveResult++) {
+    Move move = gameUtils::move(Square(TB_GET_FROM(*moveResult)), Square(TB_GET_TO(*moveResult)));
+    PieceType promotion = promotions[TB_GET_PROMOTES(*moveResult)];
+
+    moves[(*movesCount)++] = {
+      .move = promotion == NO_PIECE ? move : move | promotion,
+      .wdl = WdlScore(int(TB_GET_WDL(*moveResult)) - TB_DRAW),
+      .dtz = int(TB_GET_DTZ(*moveResult))
+    };
+  }
+
+  return true;
+#else
+  return false;
+#endif
+}
+
+// only valid right after a zeroing move and without castling rights, as the tables store them
+bool Tablebases::probeWdl([[maybe_unused]] TablebasePosition* position, [[maybe_unused]] WdlScore* wdl) {
+#ifdef SYZYGY_TABLEBASES
+  unsigned result = tb_probe_wdl(
+    position->colors[WHITE],
+    position->colors[BLACK],
+    position->pieces[KING],
+    position->pieces[QUEEN],
+    position->pieces[ROOK],
+    position->pieces[BISHOP],
+    position->pieces[KNIGHT],
+    position->pieces[PAWN],
+    position->pliesFor50MoveRule,
+    0,
+    position->enPassant == NO_SQUARE ? 0 : position->enPassant,
+    position->turn == WHITE
+  );
+
+  if (result == TB_RESULT_FAILED) {
+    return false;
+  }
+
+  *wdl = WdlScore(int(result) - TB_DRAW);
+
+  return true;
+#else
+  return false;
+#endif
+}
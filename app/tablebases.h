@@ -0,0 +1,51 @@
+#include <mutex>
+#include <string>
+
+#include "gameUtils.h"
+
+#ifndef TABLEBASES_INCLUDED
+#define TABLEBASES_INCLUDED
+
+using namespace std;
+
+enum WdlScore {
+  WDL_LOSS = -2,
+  WDL_BLESSED_LOSS = -1,
+  WDL_DRAW = 0,
+  WDL_CURSED_WIN = 1,
+  WDL_WIN = 2
+};
+
+struct TablebasePosition {
+  Bitboard colors[2];
+  Bitboard pieces[6]; // by piece type
+  Square   enPassant;
+  int      pliesFor50MoveRule;
+  Color    turn;
+};
+
+// the result of a root move for the side to move, dtz counts the plies to the next zeroing move
+struct TablebaseRootMove {
+  Move     move;
+  WdlScore wdl;
+  int      dtz;
+};
+
+// Syzygy tables are probed through Fathom (MIT), which is only built in with -DSYZYGY_TABLEBASES=ON.
+// Fathom holds one set of tables per process, so all bots share the first directory given
+class Tablebases {
+public:
+  static Tablebases* get(const string &path);
+
+  int  getCardinality();
+  bool probeRoot(TablebasePosition* position, TablebaseRootMove* moves, int* movesCount);
+  bool probeWdl(TablebasePosition* position, WdlScore* wdl);
+
+protected:
+  explicit Tablebases(int cardinality);
+
+  int   cardinality;
+  mutex rootMutex;
+};
+
+#endif // TABLEBASES_INCLUDED
@@ -0,0 +1,146 @@
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "bot.h"
+#include "gameUtils.h"
+#include "tablebases.h"
+#include "tablebasesTest.h"
+#include "utils.h"
+
+using namespace std;
+
+// every position needs the 3 and 4 piece tables only
+vector<TablebaseTest> tablebaseTests = {
+  {.fen = "8/8/8/8/8/8/1Q6/K6k w - - 0 1", .wdl = WDL_WIN, .bestMove = "", .dtz = 0},
+  {.fen = "8/8/8/8/8/8/1Q6/K6k b - - 0 1", .wdl = WDL_LOSS, .bestMove = "", .dtz = 0},
+  {.fen = "8/8/8/4k3/8/8/8/KR6 w - - 0 1", .wdl = WDL_WIN, .bestMove = "", .dtz = 0},
+  {.fen = "8/8/8/4k3/8/8/8/KR6 b - - 0 1", .wdl = WDL_LOSS, .bestMove = "", .dtz = 0},
+  {.fen = "1k6/8/8/8/8/8/P7/K7 w - - 0 1", .wdl = WDL_DRAW, .bestMove = "", .dtz = 0},
+  {.fen = "8/8/8/8/8/8/6Qk/K7 b - - 0 1", .wdl = WDL_DRAW, .bestMove = "h2g2", .dtz = 0},
+  {.fen = "8/8/8/4k3/8/8/8/KNN5 w - - 0 1", .wdl = WDL_DRAW, .bestMove = "", .dtz = 0},
+  {.fen = "8/8/8/4k3/8/8/8/KBN5 w - - 0 1", .wdl = WDL_WIN, .bestMove = "", .dtz = 0},
+  {.fen = "8/8/8/4k3/8/8/8/KBN5 b - - 0 1", .wdl = WDL_LOSS, .bestMove = "", .dtz = 0},
+  {.fen = "7k/8/6K1/8/8/8/8/1Q6 w - - 0 1", .wdl = WDL_WIN, .bestMove = "b1b8", .dtz = 1}
+};
+
+// exposes the conversion of the bot position, the tables are the ones the bot got
+class TablebasesTestBot : public Bot {
+public:
+  TablebasesTestBot(const string &fen, const string &tablebasesPath) : Bot(fen, WHITE, 1, 1, 1, tablebasesPath, "", "") {}
+
+  bool hasTablebases() {
+    return this->tablebases != nullptr;
+  }
+
+  // the reply still counts towards the same zeroing move
+  bool isQuietReply() {
+    return this->pliesFor50MoveRule != 0 && !this->isNoMoves();
+  }
+
+  // the best move the way the bot ranks them: the best result, then the shortest win or the longest loss
+  bool probeBestMove(TablebaseRootMove* bestMove) {
+    TablebasePosition position;
+    TablebaseRootMove moves[256];
+    int movesCount;
+
+    this->getTablebasePosition(&position);
+
+    if (!this->tablebases->probeRoot(&position, moves, &movesCount) || movesCount == 0) {
+      return false;
+    }
+
+    *bestMove = moves[0];
+
+    for (int i = 1; i < movesCount; i++) {
+      if (
+        moves[i].wdl > bestMove->wdl
+        || (moves[i].wdl == bestMove->wdl && moves[i].wdl > WDL_DRAW && moves[i].dtz < bestMove->dtz)
+        || (moves[i].wdl == bestMove->wdl && moves[i].wdl < WDL_DRAW && moves[i].dtz > bestMove->dtz)
+      ) {
+        *bestMove = moves[i];
+      }
+    }
+
+    return true;
+  }
+
+  bool probeWdl(WdlScore* wdl) {
+    TablebasePosition position;
+
+    this->getTablebasePosition(&position);
+
+    return this->tablebases->probeWdl(&position, wdl);
+  }
+};
+
+bool runTablebaseTest(const TablebaseTest &test, const string &tablebasesPath) {
+  TablebasesTestBot bot(test.fen, tablebasesPath);
+  TablebaseRootMove bestMove;
+  WdlScore wdl;
+
+  if (!bot.probeWdl(&wdl) || wdl != test.wdl) {
+    cout << "invalid wdl. fen: " << test.fen << ", expected " << test.wdl << endl;
+
+    return false;
+  }
+
+  if (!bot.probeBestMove(&bestMove) || bestMove.wdl != test.wdl) {
+    cout << "invalid root wdl. fen: " << test.fen << ", expected " << test.wdl << endl;
+
+    return false;
+  }
+
+  if (!test.bestMove.empty() && gameUtils::moveToUci(bestMove.move) != test.bestMove) {
+    cout << "invalid best move. fen: " << test.fen << ", expected " << test.bestMove << ", got " << gameUtils::moveToUci(bestMove.move) << endl;
+
+    return false;
+  }
+
+  if (test.dtz != 0 && bestMove.dtz != test.dtz) {
+    cout << "invalid dtz. fen: " << test.fen << ", expected " << test.dtz << ", got " << bestMove.dtz << endl;
+
+    return false;
+  }
+
+  bot.performMove(bestMove.move);
+
+  // after a quiet best move the opponent is one ply closer to the zeroing move, up to the rounding of the tables
+  if (test.wdl != WDL_DRAW && bot.isQuietReply()) {
+    TablebaseRootMove replyMove;
+
+    if (!bot.probeBestMove(&replyMove) || replyMove.wdl != -test.wdl || abs(replyMove.dtz - (bestMove.dtz - 1)) > 1) {
+      cout << "invalid dtz after " << gameUtils::moveToUci(bestMove.move) << ". fen: " << test.fen << ", dtz " << bestMove.dtz << endl;
+
+      return false;
+    }
+  }
+
+  cout << "fen: " << test.fen << ", wdl: " << wdl << ", best move: " << gameUtils::moveToUci(bestMove.move) << ", dtz: " << bestMove.dtz << endl;
+
+  return true;
+}
+
+bool tablebasesTest::testMain(int argc, char** argv) {
+  if (argc < 3) {
+    cerr << "usage: " << argv[0] << " --testTablebases <syzygy directory>" << endl;
+
+    return false;
+  }
+
+  if (!TablebasesTestBot(tablebaseTests[0].fen, argv[2]).hasTablebases()) {
+    cerr << "no tablebases to test" << endl;
+
+    return false;
+  }
+
+  for (auto &test : tablebaseTests) {
+    if (!runTablebaseTest(test, argv[2])) {
+      return false;
+    }
+  }
+
+  cout << utils::formatString("all tablebase tests passed", {"green", "bold"}) << endl;
+
+  return true;
+}
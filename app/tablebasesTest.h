@@ -0,0 +1,23 @@
+#include <string>
+#include <vector>
+
+#include "tablebases.h"
+
+#ifndef TABLEBASES_TEST_INCLUDED
+#define TABLEBASES_TEST_INCLUDED
+
+using namespace std;
+
+// bestMove and dtz are only checked when given, dtz belongs to the best move
+struct TablebaseTest {
+  string   fen;
+  WdlScore wdl;
+  string   bestMove;
+  int      dtz;
+};
+
+namespace tablebasesTest {
+  bool testMain(int argc, char** argv);
+}
+
+#endif // TABLEBASES_TEST_INCLUDED
@@ -0,0 +1,129 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+
+#include "gameUtils.h"
+#include "transpositionTable.h"
+
+using namespace std;
+
+const uint8_t GENERATION_STEP = 1 << 2;
+
+inline TranspositionEntry unpackEntry(uint64_t data) {
+  TranspositionEntry entry;
+
+  entry.score = int32_t(uint32_t(data));
+  entry.move = uint16_t(data >> 32);
+  entry.depth = int8_t(data >> 48);
+  entry.generation = uint8_t(data >> 56);
+
+  return entry;
+}
+
+inline uint64_t packEntry(const TranspositionEntry &entry) {
+  return (
+    uint64_t(uint32_t(entry.score))
+    | uint64_t(entry.move) << 32
+    | uint64_t(uint8_t(entry.depth)) << 48
+    | uint64_t(entry.generation) << 56
+  );
+}
+
+TranspositionTable::TranspositionTable(int sizeMb) {
+  size_t maxBucketCount = max((size_t)sizeMb * 1024 * 1024 / sizeof(TranspositionBucket), (size_t)1);
+
+  this->bucketCount = 1;
+
+  while (this->bucketCount * 2 <= maxBucketCount) {
+    this->bucketCount *= 2;
+  }
+
+  this->buckets = new TranspositionBucket[this->bucketCount];
+
+  this->clear();
+}
+
+TranspositionTable::~TranspositionTable() {
+  delete[] this->buckets;
+}
+
+void TranspositionTable::clear() {
+  for (size_t i = 0; i < this->bucketCount; i++) {
+    for (auto &slot : this->buckets[i].slots) {
+      slot.key.store(0ULL, memory_order_relaxed);
+      slot.data.store(0ULL, memory_order_relaxed);
+    }
+  }
+}
+
+void TranspositionTable::newSearch() {
+  this->generation += GENERATION_STEP;
+}
+
+bool TranspositionTable::probe(ZobristKey key, TranspositionEntry* entry) {
+  TranspositionBucket* bucket = this->getBucket(key);
+
+  for (auto &slot : bucket->slots) {
+    uint64_t data = slot.data.load(memory_order_relaxed);
+
+    if ((slot.key.load(memory_order_relaxed) ^ data) == key) {
+      *entry = unpackEntry(data);
+
+      return entry->bound() != NO_BOUND;
+    }
+  }
+
+  return false;
+}
+
+void TranspositionTable::store(ZobristKey key, int depth, Bound bound, Score score, Move move) {
+  TranspositionBucket* bucket = this->getBucket(key);
+  TranspositionSlot* replaced = &bucket->slots[0];
+  TranspositionEntry replacedEntry = unpackEntry(replaced->data.load(memory_order_relaxed));
+  bool isSameKey = false;
+  int minWorth = INT32_MAX;
+
+  for (auto &slot : bucket->slots) {
+    uint64_t data = slot.data.load(memory_order_relaxed);
+    TranspositionEntry entry = unpackEntry(data);
+
+    if ((slot.key.load(memory_order_relaxed) ^ data) == key) {
+      replaced = &slot;
+      replacedEntry = entry;
+      isSameKey = true;
+
+      // keep the deeper result of the current search unless the new one is exact
+      if (
+        bound != EXACT_BOUND
+        && entry.depth > depth
+        && (entry.generation & ~3) == this->generation
+      ) {
+        return;
+      }
+
+      break;
+    }
+
+    // entries from older searches and shallow entries are replaced first
+    int age = (uint8_t)(this->generation - (entry.generation & ~3)) / GENERATION_STEP;
+    int worth = entry.bound() == NO_BOUND ? INT32_MIN : entry.depth - 8 * age;
+
+    if (worth < minWorth) {
+      minWorth = worth;
+      replaced = &slot;
+      replacedEntry = entry;
+    }
+  }
+
+  TranspositionEntry entry;
+
+  entry.score = score;
+  entry.move = move == NO_MOVE && isSameKey ? replacedEntry.move : uint16_t(move);
+  entry.depth = depth;
+  entry.generation = uint8_t(this->generation | uint8_t(bound));
+
+  uint64_t data = packEntry(entry);
+
+  replaced->key.store(key ^ data, memory_order_relaxed);
+  replaced->data.store(data, memory_order_relaxed);
+}
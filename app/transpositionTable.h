@@ -0,0 +1,67 @@
+#include <atomic>
+#include <cstdint>
+
+#include "gameUtils.h"
+
+#ifndef TRANSPOSITION_TABLE_INCLUDED
+#define TRANSPOSITION_TABLE_INCLUDED
+
+using namespace std;
+
+enum Bound : uint8_t {
+  NO_BOUND,
+  UPPER_BOUND,
+  LOWER_BOUND,
+  EXACT_BOUND = UPPER_BOUND | LOWER_BOUND
+};
+
+struct TranspositionEntry {
+  int32_t  score      = 0;
+  uint16_t move       = NO_MOVE;
+  int8_t   depth      = 0;
+  uint8_t  generation = 0; // upper 6 bits - search generation, lower 2 bits - bound
+
+  inline Bound  bound() const {
+    return Bound(this->generation & 3);
+  };
+  inline Move   getMove() const {
+    return Move(this->move);
+  };
+  inline Score  getScore() const {
+    return Score(this->score);
+  };
+};
+
+// entries are shared between search threads without locks: the key is stored xor-ed with the data,
+// so an entry torn by a concurrent write fails the key check instead of returning garbage
+struct TranspositionSlot {
+  atomic<uint64_t> key;
+  atomic<uint64_t> data;
+};
+
+const int TRANSPOSITION_BUCKET_SIZE = 4;
+
+struct alignas(64) TranspositionBucket {
+  TranspositionSlot slots[TRANSPOSITION_BUCKET_SIZE];
+};
+
+class TranspositionTable {
+public:
+  explicit TranspositionTable(int sizeMb);
+  ~TranspositionTable();
+  void clear();
+  void newSearch();
+  bool probe(ZobristKey key, TranspositionEntry* entry);
+  void store(ZobristKey key, int depth, Bound bound, Score score, Move move);
+
+protected:
+  TranspositionBucket* buckets;
+  size_t               bucketCount;
+  uint8_t              generation = 0;
+
+  inline TranspositionBucket* getBucket(ZobristKey key) {
+    return &this->buckets[key & (this->bucketCount - 1)];
+  };
+};
+
+#endif // TRANSPOSITION_TABLE_INCLUDED
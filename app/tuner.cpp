@@ -0,0 +1,330 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bot.h"
+#include "evalWeights.h"
+#include "gameUtils.h"
+#include "tuner.h"
+#include "utils.h"
+
+using namespace std;
+using namespace std::chrono;
+
+const double ADAM_BETA1 = 0.9;
+const double ADAM_BETA2 = 0.999;
+const double ADAM_EPSILON = 1e-8;
+const int TUNING_DEFAULT_ITERATIONS = 1000;
+// how far one step may move the evaluation, a pawn is worth 1000
+const double TUNING_LEARNING_RATE = 10;
+// piece-square values are multiplied by 10 in the evaluation
+const double TUNING_PIECE_SQUARE_SCALE = 10;
+const int TUNING_REPORT_INTERVAL = 50;
+const int TUNING_SCALING_SEARCH_STEPS = 30;
+const string STANDARD_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+// splits [0, size) into one contiguous range per thread
+void runInParallel(int threadCount, size_t size, const function<void(int, size_t, size_t)> &run) {
+  vector<thread> threads;
+
+  for (int i = 0; i < threadCount; i++) {
+    threads.emplace_back(run, i, size * i / threadCount, size * (i + 1) / threadCount);
+  }
+
+  for (auto &thread : threads) {
+    thread.join();
+  }
+}
+
+// the first 4 fields are the position, the result comes as "1-0", "0-1", "1/2-1/2" or [1.0], [0.5], [0.0]
+bool parsePosition(const string &line, string* fen, double* result) {
+  istringstream stream(line);
+  vector<string> fields;
+  string field;
+
+  while (fields.size() < 6 && stream >> field) {
+    fields.push_back(field);
+  }
+
+  if (fields.size() < 4) {
+    return false;
+  }
+
+  bool hasCounters = (
+    fields.size() == 6
+    && all_of(fields[4].begin(), fields[4].end(), ::isdigit)
+    && all_of(fields[5].begin(), fields[5].end(), ::isdigit)
+  );
+
+  *fen = fields[0] + " " + fields[1] + " " + fields[2] + " " + fields[3] + (hasCounters ? " " + fields[4] + " " + fields[5] : " 0 1");
+
+  if (line.find("1/2-1/2") != string::npos || line.find("[0.5]") != string::npos) {
+    *result = 0.5;
+  } else if (line.find("1-0") != string::npos || line.find("[1.0]") != string::npos) {
+    *result = 1;
+  } else if (line.find("0-1") != string::npos || line.find("[0.0]") != string::npos) {
+    *result = 0;
+  } else {
+    return false;
+  }
+
+  return true;
+}
+
+inline double evalPosition(const TuningDataset &dataset, const TuningPosition &position, const vector<double> &weights) {
+  double score = position.fixedScore;
+
+  for (uint32_t i = 0; i < position.coefficientsCount; i++) {
+    const TuningCoefficient &coefficient = dataset.coefficients[position.coefficientsStart + i];
+
+    score += weights[coefficient.weight] * coefficient.value;
+  }
+
+  return score;
+}
+
+// expected result for white, the scaling turns the score into a winning probability
+inline double sigmoid(double score, double scaling) {
+  return 1 / (1 + pow(10, -scaling * score / 4000));
+}
+
+double computeError(const TuningDataset &dataset, const vector<double> &weights, double scaling, int threadCount) {
+  vector<double> errors(threadCount, 0);
+
+  runInParallel(threadCount, dataset.positions.size(), [&](int threadIndex, size_t start, size_t end) {
+    double error = 0;
+
+    for (size_t i = start; i < end; i++) {
+      const TuningPosition &position = dataset.positions[i];
+      double difference = position.result - sigmoid(evalPosition(dataset, position, weights), scaling);
+
+      error += difference * difference;
+    }
+
+    errors[threadIndex] = error;
+  });
+
+  double error = 0;
+
+  for (auto &threadError : errors) {
+    error += threadError;
+  }
+
+  return error / dataset.positions.size();
+}
+
+void computeGradient(const TuningDataset &dataset, const vector<double> &weights, double scaling, int threadCount, vector<double>* gradient) {
+  vector<vector<double>> gradients(threadCount, vector<double>(EVAL_WEIGHTS_COUNT, 0));
+
+  runInParallel(threadCount, dataset.positions.size(), [&](int threadIndex, size_t start, size_t end) {
+    vector<double> &threadGradient = gradients[threadIndex];
+
+    for (size_t i = start; i < end; i++) {
+      const TuningPosition &position = dataset.positions[i];
+      double expected = sigmoid(evalPosition(dataset, position, weights), scaling);
+      double derivative = (expected - position.result) * expected * (1 - expected);
+
+      for (uint32_t j = 0; j < position.coefficientsCount; j++) {
+        const TuningCoefficient &coefficient = dataset.coefficients[position.coefficientsStart + j];
+
+        threadGradient[coefficient.weight] += derivative * coefficient.value;
+      }
+    }
+  });
+
+  // d(error)/d(weight) = 2 / N * sum((sigmoid - result) * sigmoid' * coefficient)
+  double factor = 2 * scaling * log(10) / 4000 / dataset.positions.size();
+
+  for (int weight = 0; weight < EVAL_WEIGHTS_COUNT; weight++) {
+    double sum = 0;
+
+    for (auto &threadGradient : gradients) {
+      sum += threadGradient[weight];
+    }
+
+    (*gradient)[weight] = sum * factor;
+  }
+}
+
+// every position is evaluated once: the coefficients of the weights make up the rest of the tuning
+void loadDataset(const string &positionsPath, int threadCount, TuningDataset* dataset) {
+  ifstream file(positionsPath);
+  vector<string> lines;
+  string line;
+
+  while (getline(file, line)) {
+    lines.push_back(line);
+  }
+
+  vector<TuningDataset> threadDatasets(threadCount);
+
+  runInParallel(threadCount, lines.size(), [&](int threadIndex, size_t start, size_t end) {
+    TuningDataset &threadDataset = threadDatasets[threadIndex];
+    Bot bot(STANDARD_FEN, WHITE, 1, 1, 1, "", "", "");
+
+    for (size_t i = start; i < end; i++) {
+      string fen;
+      double result;
+
+      if (!parsePosition(lines[i], &fen, &result)) {
+        continue;
+      }
+
+      EvalTrace trace;
+
+      bot.setPosition(fen);
+
+      int fixedScore = bot.traceEval(&trace);
+      uint32_t coefficientsStart = threadDataset.coefficients.size();
+
+      for (int weight = 0; weight < EVAL_WEIGHTS_COUNT; weight++) {
+        if (trace.coefficients[weight] != 0) {
+          fixedScore -= *evalWeights::getWeight(weight) * trace.coefficients[weight];
+
+          threadDataset.coefficients.push_back({
+            .weight = uint16_t(weight),
+            .value = int16_t(trace.coefficients[weight])
+          });
+        }
+      }
+
+      threadDataset.positions.push_back({
+        .result = result,
+        .fixedScore = fixedScore,
+        .coefficientsStart = coefficientsStart,
+        .coefficientsCount = uint32_t(threadDataset.coefficients.size() - coefficientsStart)
+      });
+    }
+  });
+
+  for (auto &threadDataset : threadDatasets) {
+    uint32_t offset = dataset->coefficients.size();
+
+    for (auto &position : threadDataset.positions) {
+      position.coefficientsStart += offset;
+
+      dataset->positions.push_back(position);
+    }
+
+    dataset->coefficients.insert(dataset->coefficients.end(), threadDataset.coefficients.begin(), threadDataset.coefficients.end());
+  }
+}
+
+// the scaling that fits the current weights best, the error is unimodal in it
+double findScaling(const TuningDataset &dataset, const vector<double> &weights, int threadCount) {
+  double low = 0;
+  double high = 10;
+
+  for (int i = 0; i < TUNING_SCALING_SEARCH_STEPS; i++) {
+    double middle1 = low + (high - low) / 3;
+    double middle2 = high - (high - low) / 3;
+
+    if (computeError(dataset, weights, middle1, threadCount) < computeError(dataset, weights, middle2, threadCount)) {
+      high = middle2;
+    } else {
+      low = middle1;
+    }
+  }
+
+  return (low + high) / 2;
+}
+
+void saveWeights(const vector<double> &weights, const string &weightsPath) {
+  for (int weight = 0; weight < EVAL_WEIGHTS_COUNT; weight++) {
+    *evalWeights::getWeight(weight) = int(round(weights[weight]));
+  }
+
+  evalWeights::save(weightsPath);
+}
+
+void tuner::tune(const string &positionsPath, const string &weightsPath, int threadCount, int iterations) {
+  if (!ifstream(positionsPath)) {
+    cerr << "failed to open " << positionsPath << endl;
+
+    return;
+  }
+
+  auto start = high_resolution_clock::now();
+  TuningDataset dataset;
+
+  loadDataset(positionsPath, threadCount, &dataset);
+
+  if (dataset.positions.empty()) {
+    cerr << "no positions with results in " << positionsPath << endl;
+
+    return;
+  }
+
+  cout
+    << "positions: " << utils::formatString(to_string(dataset.positions.size()), {"blue", "bold"})
+    << ", time: " << duration_cast<milliseconds>(high_resolution_clock::now() - start).count() << " ms" << endl;
+
+  vector<double> weights(EVAL_WEIGHTS_COUNT);
+  vector<double> gradient(EVAL_WEIGHTS_COUNT, 0);
+  vector<double> moments(EVAL_WEIGHTS_COUNT, 0);
+  vector<double> velocities(EVAL_WEIGHTS_COUNT, 0);
+
+  for (int weight = 0; weight < EVAL_WEIGHTS_COUNT; weight++) {
+    weights[weight] = *evalWeights::getWeight(weight);
+  }
+
+  double scaling = findScaling(dataset, weights, threadCount);
+
+  cout
+    << "scaling: " << utils::formatString(to_string(scaling), {"green", "bold"})
+    << ", error: " << utils::formatString(to_string(computeError(dataset, weights, scaling, threadCount)), {"red", "bold"}) << endl;
+
+  // adam: every weight gets its own step size, so rarely seen piece-square values still move
+  for (int iteration = 1; iteration <= iterations; iteration++) {
+    computeGradient(dataset, weights, scaling, threadCount, &gradient);
+
+    for (int weight = 0; weight < EVAL_WEIGHTS_COUNT; weight++) {
+      double learningRate = weight >= MG_PIECE_SQUARE_WEIGHTS
+        ? TUNING_LEARNING_RATE / TUNING_PIECE_SQUARE_SCALE
+        : TUNING_LEARNING_RATE;
+
+      moments[weight] = ADAM_BETA1 * moments[weight] + (1 - ADAM_BETA1) * gradient[weight];
+      velocities[weight] = ADAM_BETA2 * velocities[weight] + (1 - ADAM_BETA2) * gradient[weight] * gradient[weight];
+
+      double moment = moments[weight] / (1 - pow(ADAM_BETA1, iteration));
+      double velocity = velocities[weight] / (1 - pow(ADAM_BETA2, iteration));
+
+      weights[weight] -= learningRate * moment / (sqrt(velocity) + ADAM_EPSILON);
+    }
+
+    if (iteration % TUNING_REPORT_INTERVAL == 0 || iteration == iterations) {
+      saveWeights(weights, weightsPath);
+
+      cout
+        << "iteration: " << utils::formatString(to_string(iteration), {"blue", "bold"})
+        << ", error: " << utils::formatString(to_string(computeError(dataset, weights, scaling, threadCount)), {"red", "bold"})
+        << ", time: " << duration_cast<milliseconds>(high_resolution_clock::now() - start).count() << " ms" << endl;
+    }
+  }
+}
+
+void tuner::tuneMain(int argc, char** argv) {
+  int iterations = TUNING_DEFAULT_ITERATIONS;
+  int threadCount = max(int(thread::hardware_concurrency()), 1);
+
+  if (
+    argc < 4
+    || (argc > 4 && !utils::parsePositiveInt(argv[4], &iterations))
+    || (argc > 5 && !utils::parsePositiveInt(argv[5], &threadCount))
+  ) {
+    cerr
+      << "usage: " << argv[0] << " --tune <positions.epd> <weights.txt> [iterations] [threads]" << endl
+      << "iterations and threads are positive integers" << endl;
+
+    return;
+  }
+
+  tuner::tune(argv[2], argv[3], threadCount, iterations);
+}
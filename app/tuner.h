@@ -0,0 +1,35 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "evalWeights.h"
+
+#ifndef TUNER_INCLUDED
+#define TUNER_INCLUDED
+
+using namespace std;
+
+struct TuningCoefficient {
+  uint16_t weight;
+  int16_t  value;
+};
+
+// the evaluation is linear in the weights: the score is the untuned part plus the weights times the coefficients
+struct TuningPosition {
+  double   result;
+  int      fixedScore;
+  uint32_t coefficientsStart;
+  uint32_t coefficientsCount;
+};
+
+struct TuningDataset {
+  vector<TuningCoefficient> coefficients;
+  vector<TuningPosition>    positions;
+};
+
+namespace tuner {
+  void tune(const string &positionsPath, const string &weightsPath, int threadCount, int iterations);
+  void tuneMain(int argc, char** argv);
+}
+
+#endif // TUNER_INCLUDED
@@ -62,6 +62,7 @@ export interface LichessGameState {
   binc: number;
   wdraw: boolean;
   bdraw: boolean;
+  status: string;
 }
 
 export interface LichessChallengeEvent {
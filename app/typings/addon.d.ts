@@ -1,9 +1,17 @@
 declare module '*.node' {
+  export interface SearchOptions {
+    maxNodes?: number;
+    deadlineMs?: number;
+  }
+
   export default class Bot {
-    constructor(fen: string, color: 0 | 1, searchDepth: number);
+    constructor(fen: string, color: 0 | 1, maxSearchDepth: number, transpositionTableSize: number, threadCount: number, tablebasesPath?: string, bookPath?: string, nnuePath?: string);
 
     applyMoves(moves: string): void;
     destroy(): void;
-    makeMove(): number | null;
+    makeMove(timeLeft: number, increment: number, options?: SearchOptions): number | null;
+    makeMoveAsync(timeLeft: number, increment: number, options?: SearchOptions): Promise<number | null>;
+    ponder(move: number): number | null;
+    stop(): void;
   }
 }
@@ -1,3 +1,4 @@
+#include <charconv>
 #include <iostream>
 #include <string>
 #include <vector>
@@ -26,6 +27,20 @@ string utils::formatString(const string &str, vector<string> formats) {
   return result;
 }
 
+// the whole string has to be a number that fits an int, the value is left untouched otherwise
+bool utils::parsePositiveInt(const string &str, int* value) {
+  int parsed;
+  auto [end, error] = from_chars(str.data(), str.data() + str.size(), parsed);
+
+  if (error != errc() || end != str.data() + str.size() || parsed < 1) {
+    return false;
+  }
+
+  *value = parsed;
+
+  return true;
+}
+
 int utils::sign(int number) {
   return (number > 0) - (number < 0);
 }
@@ -66,6 +66,7 @@ ostream& operator<<(ostream &out, const vector<T> &v) {
 
 namespace utils {
   string         formatString(const string &str, vector<string> formats);
+  bool           parsePositiveInt(const string &str, int* value);
   int            sign(int number);
   vector<string> split(const string &str, const string &delimiter);
 }
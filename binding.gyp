@@ -1,4 +1,8 @@
 {
+    "variables": {
+        "fathom_dir%": "",
+        "native_arch%": "false"
+    },
     "targets": [{
         "target_name": "addon",
         "cflags!": ["-fno-exceptions"],
@@ -6,11 +10,28 @@
         "sources": [
             "app/api.cpp",
             "app/bot.cpp",
+            "app/evalWeights.cpp",
             "app/game.cpp",
             "app/gameUtils.cpp",
             "app/init.cpp",
+            "app/nnue.cpp",
+            "app/openingBook.cpp",
+            "app/pawnTable.cpp",
+            "app/searchPool.cpp",
+            "app/tablebases.cpp",
+            "app/transpositionTable.cpp",
             "app/utils.cpp"
         ],
+        "conditions": [
+            ["native_arch == 'true'", {
+                "cflags_cc": ["-march=native"]
+            }],
+            ["fathom_dir != ''", {
+                "sources": ["<(fathom_dir)/src/tbprobe.c"],
+                "include_dirs": ["<(fathom_dir)/src"],
+                "defines": ["SYZYGY_TABLEBASES"]
+            }]
+        ],
         "include_dirs": [
             "<!@(node -p \"require('node-addon-api').include\")"
         ],
@@ -18,6 +39,6 @@
         "dependencies": [
             "<!(node -p \"require('node-addon-api').gyp\")"
         ],
-        "defines": ["NAPI_DISABLE_CPP_EXCEPTIONS"]
+        "defines": ["NAPI_DISABLE_CPP_EXCEPTIONS", "NAPI_VERSION=4"]
     }]
 }